@@ -0,0 +1,655 @@
+#include "internal.h"
+
+/**
+ * 列式导出
+ *
+ * 顺序扫描全部元数据，把头部的定长字段保存为数组，把属性值保存为字典编码的列，
+ * 写入单独的文件。统计时只需映射该文件并对需要的列求和，不必再读取每个元数据块。
+ *
+ * 定长字段的列名以 @ 开头: @offset、@lenOriginal、@lenCompressed、@compression、
+ * @numChunk，其余各列的列名为属性名。
+ */
+
+typedef struct _ColumnBuilder   ColumnBuilder;
+typedef struct _ColumnsBuilder  ColumnsBuilder;
+
+#define _EXPORT_WINDOW_SIZE     (4 * 1024 * 1024)   // 导出时的窗口大小 (4MB)
+#define _ROWS_INIT_CAPACITY     1024
+#define _DICT_INIT_CAPACITY     64                  // 字典哈希表的初始大小 (2 的整次幂)
+
+// 属性值的列
+struct _ColumnBuilder {
+    WPDP_String     name;
+    uint32_t        *codes;         // 各行的编号
+    uint8_t         *values;        // 字典各项的值
+    int             values_length;
+    int             values_capacity;
+    uint32_t        *offsets;       // 字典各项的值在 values 中的位置 (count + 1 项)
+    int             count;          // 字典的项数
+    int             offsets_capacity;
+    uint32_t        *slots;         // 哈希表，保存编号，0 表示空
+    int             slot_count;
+};
+
+struct _ColumnsBuilder {
+    int             rows;
+    int             rows_capacity;
+    int64_t         *offset;
+    int64_t         *len_original;
+    int64_t         *len_compressed;
+    uint8_t         *compression;
+    int32_t         *num_chunk;
+    ColumnBuilder   *columns;
+    int             column_count;
+    int             columns_capacity;
+};
+
+struct _WPDP_Columns {
+    const uint8_t               *data;
+    int64_t                     length;
+    const StructColumnsHeader   *header;
+    const StructColumn          *columns;
+};
+
+static const char *_FIXED_NAMES[] = {
+    "@offset", "@lenOriginal", "@lenCompressed", "@compression", "@numChunk"
+};
+#define _FIXED_COUNT    5
+
+static int _builder_add_row(ColumnsBuilder *builder, StructMetadata *metadata, int64_t offset);
+static ColumnBuilder *_builder_get_column(ColumnsBuilder *builder, WPDP_String *name, int hint);
+static uint32_t _column_add_value(ColumnBuilder *column, WPDP_String *value);
+static void _column_grow_slots(ColumnBuilder *column);
+static void _builder_free(ColumnsBuilder *builder);
+static int _builder_write(ColumnsBuilder *builder, WPIO_Stream *stream);
+static int _write(WPIO_Stream *stream, const void *data, int64_t length, int64_t *position);
+static int _write_padding(WPIO_Stream *stream, int64_t *position);
+static int64_t _align(int64_t position);
+
+static const StructColumn *_find_column(const WPDP_Columns *columns, const char *name);
+static bool _range_valid(int64_t offset, int64_t size, int64_t length);
+
+/**
+ * 把全部条目的元数据导出为列式文件
+ *
+ * @param stream  导出文件的操作对象
+ */
+int columns_export(WPDP *dp, WPIO_Stream *stream) {
+    ColumnsBuilder builder;
+    WPDP_Iterator *iterator;
+    int rc;
+
+    if (!wpio_is_writable(stream)) {
+        error_set_msg("The specified stream is not writable");
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    rc = wpdp_iterator_init_windowed(dp, _EXPORT_WINDOW_SIZE, &iterator);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    memset(&builder, 0, sizeof(builder));
+
+    while (iterator->current != NULL) {
+        rc = _builder_add_row(&builder, iterator->current->metadata, iterator->current->offset);
+        if (rc != WPDP_OK) {
+            break;
+        }
+
+        rc = wpdp_iterator_next(iterator);
+        if (rc == WPDP_ERROR_OUT_OF_BOUNDS) {
+            rc = WPDP_OK;
+            break;
+        }
+        if (rc != WPDP_OK) {
+            break;
+        }
+    }
+
+    wpdp_iterator_free(iterator);
+
+    if (rc == WPDP_OK) {
+        rc = _builder_write(&builder, stream);
+    }
+
+    _builder_free(&builder);
+
+    return rc;
+}
+
+/**
+ * 打开映射到内存中的列式文件
+ *
+ * 不复制数据，使用期间 data 必须有效
+ *
+ * @param data         文件内容
+ * @param length       文件长度
+ * @param columns_out  列式文件对象，使用完毕后用 wpdp_columns_close() 释放
+ */
+WPDP_API int wpdp_columns_open(const void *data, int64_t length, WPDP_Columns **columns_out) {
+    const StructColumnsHeader *header = (const StructColumnsHeader *)data;
+    const StructColumn *columns;
+    WPDP_Columns *cols;
+    int i;
+
+    if (length < (int64_t)sizeof(StructColumnsHeader) || header->signature != COLUMNS_SIGNATURE) {
+        error_set_msg("Not a columns file");
+        return WPDP_ERROR_FILE_BROKEN;
+    }
+    if (header->version != COLUMNS_VERSION) {
+        error_set_msg("Unsupported columns file version: %d", header->version);
+        return WPDP_ERROR_NOT_COMPATIBLE;
+    }
+    // 每行在每个整数列中至少占 1 字节，行数不会超过文件长度
+    if (header->numRows < 0 || header->numRows > length || header->numColumns < 0
+        || header->ofsColumns % COLUMNS_ALIGNMENT != 0
+        || !_range_valid(header->ofsColumns, (int64_t)sizeof(StructColumn) * header->numColumns, length)) {
+        error_set_msg("Broken columns file header");
+        return WPDP_ERROR_FILE_BROKEN;
+    }
+
+    columns = (const StructColumn *)((const uint8_t *)data + header->ofsColumns);
+
+    for (i = 0; i < header->numColumns; i++) {
+        const StructColumn *column = &columns[i];
+        int width;
+
+        switch (column->type) {
+            case COLUMN_TYPE_INT64:
+                width = 8;
+                break;
+            case COLUMN_TYPE_UINT8:
+                width = 1;
+                break;
+            case COLUMN_TYPE_INT32:
+            case COLUMN_TYPE_DICT:
+                width = 4;
+                break;
+            default:
+                error_set_msg("Unknown type %d of column %d", column->type, i);
+                return WPDP_ERROR_FILE_BROKEN;
+        }
+
+        if (!_range_valid(column->ofsName, column->lenName, length)
+            || column->ofsData % COLUMNS_ALIGNMENT != 0
+            || column->lenData != width * header->numRows
+            || !_range_valid(column->ofsData, column->lenData, length)
+            || (column->type == COLUMN_TYPE_DICT
+                && (column->numDict < 0
+                    || column->ofsDict % COLUMNS_ALIGNMENT != 0
+                    || !_range_valid(column->ofsDict, column->lenDict, length)
+                    || column->lenDict < (int64_t)sizeof(uint32_t) * ((int64_t)column->numDict + 1)))) {
+            error_set_msg("Broken column %d", i);
+            return WPDP_ERROR_FILE_BROKEN;
+        }
+    }
+
+    cols = wpdp_new_zero(WPDP_Columns, 1);
+    cols->data = (const uint8_t *)data;
+    cols->length = length;
+    cols->header = header;
+    cols->columns = columns;
+
+    *columns_out = cols;
+
+    return WPDP_OK;
+}
+
+WPDP_API int wpdp_columns_close(WPDP_Columns *columns) {
+    wpdp_free(columns);
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取行数 (条目数量)
+ */
+WPDP_API int64_t wpdp_columns_get_row_count(WPDP_Columns *columns) {
+    return columns->header->numRows;
+}
+
+/**
+ * 对整数列求和
+ *
+ * @param name     列名
+ * @param sum_out  和
+ */
+WPDP_API int wpdp_columns_sum(WPDP_Columns *columns, const char *name, int64_t *sum_out) {
+    const StructColumn *column = _find_column(columns, name);
+    int64_t rows = columns->header->numRows;
+    int64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int64_t i = 0;
+
+    if (column == NULL) {
+        error_set_msg("Column %s not found", name);
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    // 用 4 个累加器展开循环，便于编译器向量化
+    if (column->type == COLUMN_TYPE_INT64) {
+        const int64_t *values = (const int64_t *)(columns->data + column->ofsData);
+        for (; i + 4 <= rows; i += 4) {
+            s0 += values[i];
+            s1 += values[i + 1];
+            s2 += values[i + 2];
+            s3 += values[i + 3];
+        }
+        for (; i < rows; i++) {
+            s0 += values[i];
+        }
+    } else if (column->type == COLUMN_TYPE_INT32) {
+        const int32_t *values = (const int32_t *)(columns->data + column->ofsData);
+        for (; i + 4 <= rows; i += 4) {
+            s0 += values[i];
+            s1 += values[i + 1];
+            s2 += values[i + 2];
+            s3 += values[i + 3];
+        }
+        for (; i < rows; i++) {
+            s0 += values[i];
+        }
+    } else if (column->type == COLUMN_TYPE_UINT8) {
+        const uint8_t *values = columns->data + column->ofsData;
+        for (; i < rows; i++) {
+            s0 += values[i];
+        }
+    } else {
+        error_set_msg("Column %s is not an integer column", name);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    *sum_out = s0 + s1 + s2 + s3;
+
+    return WPDP_OK;
+}
+
+/**
+ * 统计属性值等于指定值的行数
+ *
+ * @param name       列名 (属性名)
+ * @param value      属性值
+ * @param count_out  行数
+ */
+WPDP_API int wpdp_columns_count_value(WPDP_Columns *columns, const char *name, const char *value,
+                                      int64_t *count_out) {
+    const StructColumn *column = _find_column(columns, name);
+    const uint32_t *offsets;
+    const uint32_t *codes;
+    const uint8_t *strings;
+    int64_t strings_length;
+    uint32_t code = 0;
+    int64_t count = 0;
+    int64_t i;
+    int len = (int)strlen(value);
+    int n;
+
+    if (column == NULL || column->type != COLUMN_TYPE_DICT) {
+        error_set_msg("Attribute column %s not found", name);
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    // 字典为 numDict + 1 项的位置，其后为各项的值
+    offsets = (const uint32_t *)(columns->data + column->ofsDict);
+    strings = (const uint8_t *)(offsets + column->numDict + 1);
+    strings_length = column->lenDict - (int64_t)sizeof(uint32_t) * ((int64_t)column->numDict + 1);
+
+    for (n = 0; n < column->numDict; n++) {
+        if (offsets[n] > offsets[n + 1] || offsets[n + 1] > strings_length) {
+            error_set_msg("Broken dictionary item %d of column %s", n, name);
+            return WPDP_ERROR_FILE_BROKEN;
+        }
+
+        const uint8_t *str = strings + offsets[n];
+        if ((int64_t)(offsets[n + 1] - offsets[n]) == len && memcmp(str, value, (size_t)len) == 0) {
+            code = (uint32_t)n + 1;
+            break;
+        }
+    }
+
+    if (code != 0) {
+        codes = (const uint32_t *)(columns->data + column->ofsData);
+        for (i = 0; i < columns->header->numRows; i++) {
+            count += (codes[i] == code);
+        }
+    }
+
+    *count_out = count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 检查 [offset, offset + size) 是否在文件范围之内 (不会溢出)
+ */
+static bool _range_valid(int64_t offset, int64_t size, int64_t length) {
+    return (offset >= 0 && size >= 0 && offset <= length && size <= length - offset);
+}
+
+static const StructColumn *_find_column(const WPDP_Columns *columns, const char *name) {
+    int len = (int)strlen(name);
+    int i;
+
+    for (i = 0; i < columns->header->numColumns; i++) {
+        const StructColumn *column = &columns->columns[i];
+        if (column->lenName == len && memcmp(columns->data + column->ofsName, name, (size_t)len) == 0) {
+            return column;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * 添加一行 (一个条目)
+ *
+ * @return 元数据的属性损坏时返回 struct_next_metadata_attribute() 的错误码
+ */
+static int _builder_add_row(ColumnsBuilder *builder, StructMetadata *metadata, int64_t offset) {
+    WPDP_String name, value;
+    int row = builder->rows;
+    int pos = 0;
+    int i, rc;
+
+    if (builder->rows == builder->rows_capacity) {
+        int capacity = (builder->rows_capacity == 0) ? _ROWS_INIT_CAPACITY : builder->rows_capacity * 2;
+
+        builder->offset = wpdp_realloc(builder->offset, (int)sizeof(int64_t) * capacity);
+        builder->len_original = wpdp_realloc(builder->len_original, (int)sizeof(int64_t) * capacity);
+        builder->len_compressed = wpdp_realloc(builder->len_compressed, (int)sizeof(int64_t) * capacity);
+        builder->compression = wpdp_realloc(builder->compression, capacity);
+        builder->num_chunk = wpdp_realloc(builder->num_chunk, (int)sizeof(int32_t) * capacity);
+
+        for (i = 0; i < builder->column_count; i++) {
+            ColumnBuilder *column = &builder->columns[i];
+            column->codes = wpdp_realloc(column->codes, (int)sizeof(uint32_t) * capacity);
+            memset(column->codes + builder->rows_capacity, 0,
+                   sizeof(uint32_t) * (size_t)(capacity - builder->rows_capacity));
+        }
+
+        builder->rows_capacity = capacity;
+    }
+
+    builder->offset[row] = offset;
+    builder->len_original[row] = metadata->lenOriginal;
+    builder->len_compressed[row] = metadata->lenCompressed;
+    builder->compression[row] = metadata->compression;
+    builder->num_chunk[row] = metadata->numChunk;
+
+    // 各条目的属性通常按相同的顺序排列，先尝试同一位置的列
+    for (i = 0; (rc = struct_next_metadata_attribute(metadata, &pos, &name, &value)) == WPDP_OK; i++) {
+        ColumnBuilder *column = _builder_get_column(builder, &name, i);
+        column->codes[row] = _column_add_value(column, &value);
+    }
+
+    if (rc != WPDP_ERROR_OUT_OF_BOUNDS) {
+        return rc;
+    }
+
+    builder->rows++;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取属性名对应的列，不存在时创建
+ *
+ * @param hint  优先检查的列的序号
+ */
+static ColumnBuilder *_builder_get_column(ColumnsBuilder *builder, WPDP_String *name, int hint) {
+    ColumnBuilder *column;
+    int i;
+
+    if (hint < builder->column_count && wpdp_string_compare(&builder->columns[hint].name, name) == 0) {
+        return &builder->columns[hint];
+    }
+
+    for (i = 0; i < builder->column_count; i++) {
+        if (wpdp_string_compare(&builder->columns[i].name, name) == 0) {
+            return &builder->columns[i];
+        }
+    }
+
+    if (builder->column_count == builder->columns_capacity) {
+        builder->columns_capacity = (builder->columns_capacity == 0) ? 16 : builder->columns_capacity * 2;
+        builder->columns = wpdp_realloc(builder->columns, (int)sizeof(ColumnBuilder) * builder->columns_capacity);
+    }
+
+    column = &builder->columns[builder->column_count++];
+    memset(column, 0, sizeof(ColumnBuilder));
+
+    wpdp_string_init(&column->name, WPDP_STRING_PTR(name), name->len);
+
+    column->codes = wpdp_new_zero(uint32_t, builder->rows_capacity);
+
+    column->offsets_capacity = _DICT_INIT_CAPACITY;
+    column->offsets = wpdp_new_zero(uint32_t, column->offsets_capacity + 1);
+    column->slot_count = _DICT_INIT_CAPACITY;
+    column->slots = wpdp_new_zero(uint32_t, column->slot_count);
+
+    return column;
+}
+
+/**
+ * 把属性值加入列的字典
+ *
+ * @return 属性值在字典中的编号 (从 1 开始)
+ */
+static uint32_t _column_add_value(ColumnBuilder *column, WPDP_String *value) {
+    uint32_t mask = (uint32_t)column->slot_count - 1;
+    uint32_t slot = wpdp_string_hash(value) & mask;
+
+    while (column->slots[slot] != 0) {
+        uint32_t code = column->slots[slot];
+        uint32_t begin = column->offsets[code - 1];
+        if ((int)(column->offsets[code] - begin) == value->len
+            && memcmp(column->values + begin, WPDP_STRING_PTR(value), (size_t)value->len) == 0) {
+            return code;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (column->values_length + value->len > column->values_capacity) {
+        int capacity = (column->values_capacity == 0) ? 1024 : column->values_capacity * 2;
+        while (capacity < column->values_length + value->len) {
+            capacity *= 2;
+        }
+        column->values = wpdp_realloc(column->values, capacity);
+        column->values_capacity = capacity;
+    }
+    if (column->count == column->offsets_capacity) {
+        column->offsets_capacity *= 2;
+        column->offsets = wpdp_realloc(column->offsets, (int)sizeof(uint32_t) * (column->offsets_capacity + 1));
+    }
+
+    memcpy(column->values + column->values_length, WPDP_STRING_PTR(value), (size_t)value->len);
+    column->values_length += value->len;
+    column->count++;
+    column->offsets[column->count] = (uint32_t)column->values_length;
+    column->slots[slot] = (uint32_t)column->count;
+
+    // 装填因子超过 3/4 时扩大哈希表
+    if (column->count * 4 > column->slot_count * 3) {
+        _column_grow_slots(column);
+    }
+
+    return (uint32_t)column->count;
+}
+
+static void _column_grow_slots(ColumnBuilder *column) {
+    uint32_t mask;
+    int i;
+
+    column->slot_count *= 2;
+    mask = (uint32_t)column->slot_count - 1;
+
+    wpdp_free(column->slots);
+    column->slots = wpdp_new_zero(uint32_t, column->slot_count);
+
+    for (i = 1; i <= column->count; i++) {
+        WPDP_String value = wpdp_string_view(column->values + column->offsets[i - 1],
+                                             (int)(column->offsets[i] - column->offsets[i - 1]));
+        uint32_t slot;
+
+        slot = wpdp_string_hash(&value) & mask;
+        while (column->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        column->slots[slot] = (uint32_t)i;
+    }
+}
+
+static void _builder_free(ColumnsBuilder *builder) {
+    int i;
+
+    for (i = 0; i < builder->column_count; i++) {
+        wpdp_string_clear(&builder->columns[i].name);
+        wpdp_free(builder->columns[i].codes);
+        wpdp_free(builder->columns[i].values);
+        wpdp_free(builder->columns[i].offsets);
+        wpdp_free(builder->columns[i].slots);
+    }
+
+    wpdp_free(builder->columns);
+    wpdp_free(builder->offset);
+    wpdp_free(builder->len_original);
+    wpdp_free(builder->len_compressed);
+    wpdp_free(builder->compression);
+    wpdp_free(builder->num_chunk);
+}
+
+/**
+ * 写入列式文件
+ */
+static int _builder_write(ColumnsBuilder *builder, WPIO_Stream *stream) {
+    StructColumnsHeader header;
+    StructColumn *columns;
+    const void *data[_FIXED_COUNT];
+    int num_columns = _FIXED_COUNT + builder->column_count;
+    int64_t rows = builder->rows;
+    int64_t position = 0;
+    int64_t ofs;
+    int i;
+    int rc;
+
+    data[0] = builder->offset;
+    data[1] = builder->len_original;
+    data[2] = builder->len_compressed;
+    data[3] = builder->compression;
+    data[4] = builder->num_chunk;
+
+    // 计算各部分的位置
+    columns = wpdp_new_zero(StructColumn, num_columns);
+
+    ofs = (int64_t)sizeof(StructColumnsHeader) + (int64_t)sizeof(StructColumn) * num_columns;
+    for (i = 0; i < num_columns; i++) {
+        if (i < _FIXED_COUNT) {
+            columns[i].lenName = (uint8_t)strlen(_FIXED_NAMES[i]);
+        } else {
+            columns[i].lenName = (uint8_t)builder->columns[i - _FIXED_COUNT].name.len;
+        }
+        columns[i].ofsName = ofs;
+        ofs += columns[i].lenName;
+    }
+
+    for (i = 0; i < num_columns; i++) {
+        StructColumn *column = &columns[i];
+
+        if (i < 3) {
+            column->type = COLUMN_TYPE_INT64;
+            column->lenData = rows * 8;
+        } else if (i == 3) {
+            column->type = COLUMN_TYPE_UINT8;
+            column->lenData = rows;
+        } else if (i == 4) {
+            column->type = COLUMN_TYPE_INT32;
+            column->lenData = rows * 4;
+        } else {
+            ColumnBuilder *builder_column = &builder->columns[i - _FIXED_COUNT];
+            column->type = COLUMN_TYPE_DICT;
+            column->lenData = rows * 4;
+            column->numDict = builder_column->count;
+            column->lenDict = (int64_t)sizeof(uint32_t) * (builder_column->count + 1) + builder_column->values_length;
+        }
+
+        column->ofsData = _align(ofs);
+        ofs = column->ofsData + column->lenData;
+        if (column->type == COLUMN_TYPE_DICT) {
+            column->ofsDict = _align(ofs);
+            ofs = column->ofsDict + column->lenDict;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.signature = COLUMNS_SIGNATURE;
+    header.version = COLUMNS_VERSION;
+    header.numRows = rows;
+    header.numColumns = num_columns;
+    header.ofsColumns = (int64_t)sizeof(StructColumnsHeader);
+
+    // 依次写入
+    rc = _write(stream, &header, (int64_t)sizeof(header), &position);
+    if (rc == WPDP_OK) {
+        rc = _write(stream, columns, (int64_t)sizeof(StructColumn) * num_columns, &position);
+    }
+    for (i = 0; i < num_columns && rc == WPDP_OK; i++) {
+        const void *name = (i < _FIXED_COUNT) ? _FIXED_NAMES[i] : WPDP_STRING_PTR(&builder->columns[i - _FIXED_COUNT].name);
+        rc = _write(stream, name, columns[i].lenName, &position);
+    }
+    for (i = 0; i < num_columns && rc == WPDP_OK; i++) {
+        rc = _write_padding(stream, &position);
+        if (rc != WPDP_OK) {
+            break;
+        }
+
+        if (i < _FIXED_COUNT) {
+            rc = _write(stream, data[i], columns[i].lenData, &position);
+        } else {
+            ColumnBuilder *builder_column = &builder->columns[i - _FIXED_COUNT];
+
+            rc = _write(stream, builder_column->codes, columns[i].lenData, &position);
+            if (rc == WPDP_OK) {
+                rc = _write_padding(stream, &position);
+            }
+            if (rc == WPDP_OK) {
+                rc = _write(stream, builder_column->offsets,
+                            (int64_t)sizeof(uint32_t) * (builder_column->count + 1), &position);
+            }
+            if (rc == WPDP_OK) {
+                rc = _write(stream, builder_column->values, builder_column->values_length, &position);
+            }
+        }
+    }
+
+    wpdp_free(columns);
+
+    return rc;
+}
+
+static int _write(WPIO_Stream *stream, const void *data, int64_t length, int64_t *position) {
+    if (length == 0) {
+        return WPDP_OK;
+    }
+
+    size_t len_written = wpio_write(stream, data, (size_t)length);
+    if ((int64_t)len_written != length) {
+        error_set_msg("Failed to write %lld bytes (%lld bytes written actually)",
+                      (long long)length, (long long)len_written);
+        return WPDP_ERROR_STREAM_OPERATION;
+    }
+
+    *position += length;
+
+    return WPDP_OK;
+}
+
+/**
+ * 写入填充，使下一部分按 COLUMNS_ALIGNMENT 对齐
+ */
+static int _write_padding(WPIO_Stream *stream, int64_t *position) {
+    static const uint8_t zeros[COLUMNS_ALIGNMENT] = {0};
+
+    return _write(stream, zeros, _align(*position) - *position, position);
+}
+
+static int64_t _align(int64_t position) {
+    return (position + COLUMNS_ALIGNMENT - 1) / COLUMNS_ALIGNMENT * COLUMNS_ALIGNMENT;
+}
@@ -8,7 +8,7 @@ typedef struct _SectionContentsCustom   Custom;
 
 // Contents.php: class WPDP_Contents extends WPDP_Common
 struct _SectionContentsCustom {
-    char                    _buffer[BUFFER_SIZE];
+    char                    *_buffer;       // 写入缓冲区 (只在读写方式下分配)
     int32_t                 _buffer_pos;
 };
 
@@ -21,11 +21,32 @@ int section_contents_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sec
     int rc = section_init(SECTION_TYPE_CONTENTS, stream, mode, sect_out);
     RETURN_VAL_IF_NON_ZERO(rc);
 
-    (*sect_out)->custom = wpdp_new_zero(Custom, 1);
+    Custom *custom = wpdp_new_zero(Custom, 1);
+    if (mode == WPDP_MODE_READWRITE) {
+        custom->_buffer = wpdp_malloc_zero(BUFFER_SIZE);
+        wpdp_memory_charge(WPDP_MEMORY_BUFFERS, BUFFER_SIZE);
+    }
+
+    (*sect_out)->custom = custom;
 
     return WPDP_OK;
 }
 
+/**
+ * 关闭内容区域，释放写入缓冲区
+ */
+void section_contents_close(Section *sect) {
+    Custom *custom = (Custom *)sect->custom;
+
+    if (custom->_buffer != NULL) {
+        wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, BUFFER_SIZE);
+        wpdp_free(custom->_buffer);
+    }
+
+    wpdp_free(custom);
+    section_free(sect);
+}
+
 int64_t section_contents_get_section_length(Section *sect) {
     return sect->_section->length;
 }
@@ -1,5 +1,14 @@
 #include "internal.h"
 
+/**
+ * 创建条目
+ *
+ * 条目只保存元数据的指针，属性在读取时才从元数据中解析。元数据的所有权不转移，
+ * 需要条目负责释放时由调用者设置 owns_metadata
+ *
+ * @param meta        元数据，可以为 NULL
+ * @param attributes  已解析的属性，可以为 NULL
+ */
 WPDP_Entry *wpdp_entry_create(WPDP *dp, PacketMetadata *meta, WPDP_Entry_Attributes *attributes) {
     WPDP_Entry *entry;
 
@@ -8,13 +17,76 @@ WPDP_Entry *wpdp_entry_create(WPDP *dp, PacketMetadata *meta, WPDP_Entry_Attribu
     entry->dp = dp;
 //    entry->info = info;
 
-//    meta->metadata->
+    if (meta != NULL) {
+        entry->metadata = meta->metadata;
+        entry->offset = meta->offset;
+    }
 
     entry->attributes = attributes;
 
     return entry;
 }
 
+/**
+ * 释放条目
+ */
+WPDP_API int wpdp_entry_free(WPDP_Entry *entry) {
+    if (entry->attributes != NULL) {
+        wpdp_entry_attributes_free(entry->attributes);
+    }
+    if (entry->owns_metadata) {
+        wpdp_free(entry->metadata);
+    }
+
+    wpdp_free(entry);
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取条目指定名称的属性值
+ *
+ * 只解析到找到该属性为止，属性值直接指向条目的元数据，不分配内存，只在释放条目
+ * 之前有效
+ *
+ * @param name      属性名
+ * @param view_out  属性值
+ *
+ * @return 指定属性不存在时返回 WPDP_ERROR_INVALID_ATTRIBUTE_NAME
+ */
+WPDP_API int wpdp_entry_get_attr(WPDP_Entry *entry, const char *name, WPDP_String *view_out) {
+    WPDP_String attr_name;
+
+    if (entry->metadata == NULL) {
+        error_set_msg("The entry has no metadata");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    attr_name = wpdp_string_view(name, (int)strlen(name));
+
+    return struct_get_metadata_attribute(entry->metadata, &attr_name, view_out);
+}
+
+/**
+ * 依次获取条目的各个属性
+ *
+ * 属性名和属性值直接指向条目的元数据，不分配内存
+ *
+ * @param pos        属性的位置，第一次调用前设为 0
+ * @param name_out   属性名
+ * @param value_out  属性值
+ *
+ * @return 已经没有更多属性时返回 WPDP_ERROR_OUT_OF_BOUNDS
+ */
+WPDP_API int wpdp_entry_next_attr(WPDP_Entry *entry, int *pos, WPDP_String *name_out, WPDP_String *value_out) {
+    if (entry->metadata == NULL) {
+        error_set_msg("The entry has no metadata");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    return struct_next_metadata_attribute(entry->metadata, pos, name_out, value_out);
+}
+
 
 
 #define DEFAULT_CAPACITY    10
@@ -1,16 +1,25 @@
 #include "internal.h"
+#include "thread.h"
 #include <stdarg.h>
 
-char buf_err_msg[512];
+// 每个线程使用自己的缓冲区，并行扫描的各线程可以同时设置错误信息
+WPDP_THREAD_LOCAL char buf_err_msg[ERROR_MSG_SIZE];
 
 void error_set_msg(char *format, ...) {
     va_list args;
 
     va_start(args, format);
-    vsnprintf(buf_err_msg, 512, format, args);
+    vsnprintf(buf_err_msg, ERROR_MSG_SIZE, format, args);
     va_end(args);
 
     perror("Error message: ");
     perror(buf_err_msg);
     perror("\r\n");
 }
+
+/**
+ * 获取当前线程最近一次设置的错误信息
+ */
+const char *error_get_msg(void) {
+    return buf_err_msg;
+}
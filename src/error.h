@@ -64,6 +64,9 @@
 #define WPDP_ERROR_FILE_BROKEN                  11
 #define WPDP_ERROR_STREAM_OPERATION             12
 
+#define ERROR_MSG_SIZE                          512
+
 void error_set_msg(char *format, ...);
+const char *error_get_msg(void);
 
 #endif // _ERROR_H_
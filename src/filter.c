@@ -0,0 +1,48 @@
+#include "internal.h"
+
+/**
+ * 过滤器 (Bloom filter)
+ *
+ * 用于在查找之前排除一定不存在的键，这样未命中的查找不需要读取任何结点。
+ * 第 i 个哈希函数的位置为 (h1 + i * h2) mod numBits，h1 与 h2 分别为键的
+ * 64 位哈希值经混合后的低 32 位与高 32 位。
+ */
+
+static void _get_hashes(WPDP_String *key, uint32_t *h1_out, uint32_t *h2_out);
+
+/**
+ * 检查过滤器中是否可能含有指定的键
+ *
+ * @param key  键
+ *
+ * @return 返回 false 时该键一定不存在，返回 true 时该键可能存在
+ */
+bool filter_may_contain(StructFilter *filter, WPDP_String *key) {
+    uint32_t h1, h2;
+    int i;
+
+    _get_hashes(key, &h1, &h2);
+
+    for (i = 0; i < filter->numHash; i++) {
+        uint64_t bit = ((uint64_t)h1 + (uint64_t)i * h2) % (uint64_t)filter->numBits;
+        if ((filter->blob[bit >> 3] & (1u << (bit & 7))) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void _get_hashes(WPDP_String *key, uint32_t *h1_out, uint32_t *h2_out) {
+    uint64_t hash = wpdp_string_hash64(key);
+
+    // FNV-1a 的高位分布不够均匀，再经过一次混合 (MurmurHash3 fmix64)
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+
+    *h1_out = (uint32_t)hash;
+    *h2_out = (uint32_t)(hash >> 32) | 1u;
+}
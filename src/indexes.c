@@ -1,11 +1,40 @@
 #include "internal.h"
 #include <math.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 
 /**
  * 结点缓存参数
  */
 #define _NODE_MAX_CACHE     1024    // 最大缓存数量
 #define _NODE_AVG_CACHE     768     // 平均缓存数量
+#define _NODE_MIN_CACHE     16      // 超过内存上限时至少保留的缓存数量
+
+/**
+ * 结点对象池参数
+ *
+ * 每种结点大小 (4KB ~ 64KB) 各有一个结点缓冲区与扩展 blob 的对象池
+ */
+#define _NODE_SIZE_CLASSES  5       // 结点大小的种类数量
+#define _NODE_ALIGNMENT     4096    // 结点缓冲区的对齐 (页大小)
+#define _BLOB_EX_ALIGNMENT  64      // 扩展 blob 的对齐
+#define _POOL_SLAB_OBJECTS  16      // 每次向系统申请的对象数量
+
+/**
+ * 叶子结点预读参数
+ */
+#define _PREFETCH_AFTER     2       // 沿叶子结点链表经过多少个结点后开始预读
+#define _PREFETCH_MIN       4       // 一次预读的最少结点数量
+#define _PREFETCH_MAX       64      // 一次预读的最多结点数量
+
+/**
+ * 索引信息哈希表的桶数量
+ */
+#define _INDEX_HASH_SIZE    64
+
+#define _OFFSETS_INIT_CAPACITY  16
+#define _OFFSETS_MAX_CAPACITY   (INT_MAX / (int)sizeof(int64_t))
 
 #define _BINARY_SEARCH_NOT_FOUND        -127
 #define _BINARY_SEARCH_BEYOND_LEFT      -126
@@ -37,38 +66,200 @@ static int _com_elem_key_str_distance(void *ptr_elem) {
 }
 
 static void *_std_elem_key_str_ptr(PacketNode *p_node, int distance) {
-    return ((void *)p_node->node->blob + NODE_DATA_SIZE - distance);
+    return ((void *)p_node->node->blob + NODE_DATA_SIZE_OF(p_node->node_size) - distance);
 }
 
 static void *_ext_elem_key_str_ptr(PacketNode *p_node, int distance) {
-    return ((void *)p_node->blob_ex + NODE_DATA_SIZE_EXPANDED - distance);
+    return ((void *)p_node->blob_ex + NODE_DATA_SIZE_EXPANDED_OF(p_node->node_size) - distance);
 }
 
 static int _com_elem_key_str_len(void *ptr_key_str) {
-    return ((int)(*((int8_t *)ptr_key_str)));
+    return ((int)(*((uint8_t *)ptr_key_str)));
+}
+
+/**
+ * 数值类型 (typed) 结点的布局
+ *
+ * 数值类型的结点没有键字符串区域，blob 的前半部分为 uint64 键的数组，后半部分
+ * 为 int64 值的数组，这样结点内的查找只需在连续的整数数组中进行。计数的 B+ 树
+ * 中的普通结点在值的数组之后还有 int64 子树元素数量的数组
+ */
+#define TYPED_ELEMENT_SIZE          ((int)(sizeof(uint64_t) + sizeof(int64_t)))
+#define TYPED_COUNTED_ELEMENT_SIZE  ((int)(sizeof(uint64_t) + sizeof(int64_t) * 2))
+
+static int _typed_node_capacity(PacketNode *p_node) {
+    if (p_node->counted && !p_node->node->isLeaf) {
+        return NODE_DATA_SIZE_OF(p_node->node_size) / TYPED_COUNTED_ELEMENT_SIZE;
+    }
+
+    return NODE_DATA_SIZE_OF(p_node->node_size) / TYPED_ELEMENT_SIZE;
+}
+
+static uint64_t *_typed_keys_ptr(PacketNode *p_node) {
+    return (uint64_t *)p_node->node->blob;
+}
+
+static int64_t *_typed_values_ptr(PacketNode *p_node) {
+    return (int64_t *)(p_node->node->blob + sizeof(uint64_t) * (size_t)_typed_node_capacity(p_node));
+}
+
+/**
+ * 计数的 B+ 树中普通结点的各子树元素数量
+ *
+ * 字符串类型的结点中，元素数量的数组紧接在元素数组之后 (不一定对齐)
+ */
+static void *_counts_ptr(PacketNode *p_node) {
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        return (p_node->node->blob + (sizeof(uint64_t) + sizeof(int64_t)) * (size_t)_typed_node_capacity(p_node));
+    }
+
+    return (p_node->node->blob + ELEMENT_SIZE * p_node->node->numElement);
 }
 
+typedef struct _IndexInfo IndexInfo;
+
+// 从索引表中解析出的单个索引的信息
+struct _IndexInfo {
+    WPDP_String     name;       // 属性名 (指向索引表中的数据，不单独分配)
+    uint32_t        hash;       // 属性名的哈希值
+    uint8_t         type;       // 索引类型
+    uint8_t         key_type;   // 键类型
+    int             node_size;  // 结点的块大小
+    bool            counted;    // 是否为计数的 B+ 树
+    bool            tokenized;  // 是否为分词索引
+    bool            postings;   // 叶子结点是否使用压缩的偏移量列表
+    WPDP_String     *covered;   // 叶子结点中附带的各属性名 (指向索引表中的数据)
+    int             covered_count;
+    uint8_t         token_flags;    // 分词标记
+    int64_t         ofs_root;   // 根结点的偏移量
+    int64_t         ofs_filter; // 过滤器的偏移量，为 0 时表示没有过滤器
+    StructFilter    *filter;    // 过滤器
+    StructHashDirectory *directory; // 哈希索引的目录 (仅用于 INDEX_TYPE_HASH)
+    IndexInfo       *next;      // 同一哈希桶中的下一个索引
+};
+
+typedef struct _PinnedNode PinnedNode;
+
+// 固定在内存中的内部结点 (紧凑的只读格式)
+//
+// 与 PacketNode 不同，固定的结点只保存查找所需的数据: 各子结点的偏移量与各键，
+// 所有数据与结点头部分配在同一块内存中。字符串键依次紧密排列，keys 中第 i 个
+// 键的范围为 [key_ends[i - 1], key_ends[i])
+struct _PinnedNode {
+    int64_t     offset;         // 结点的偏移量
+    int64_t     ofs_extra;      // 比第一个键还要小的键所在结点的偏移量
+    uint8_t     key_type;       // 键类型
+    int         count;          // 元素数量
+    int64_t     *children;      // 各元素对应子结点的偏移量
+    uint64_t    *typed_keys;    // 数值类型的键 (仅用于数值类型的索引)
+    uint16_t    *key_ends;      // 字符串键的结束位置 (仅用于字符串类型的索引)
+    uint8_t     *keys;          // 字符串键的数据
+};
+
+typedef struct _BatchKey BatchKey;
+typedef struct _Batch Batch;
+
+// 批量查找中的单个键
+struct _BatchKey {
+    WPDP_String     key;        // 键 (数值类型的索引为编码后的 8 字节)
+    uint64_t        typed;      // 编码后的数值类型的键
+    int             index;      // 在调用者的键数组中的下标
+    int64_t         child;      // 在当前结点中所属子结点的偏移量 (临时)
+};
+
+// 批量查找的状态
+struct _Batch {
+    IndexInfo           *info;
+    BatchKey            *keys;      // 按键排序
+    WPDP_QueryCallback  callback;
+    void                *arg;
+    int64_t             *offsets;   // 上一个键的查找结果 (用于重复的键)
+    int                 count;
+};
+
 typedef struct _SectionIndexesCustom Custom;
 
 // Indexes.php: class WPDP_Indexes extends WPDP_Common
 struct _SectionIndexesCustom {
     StructIndexTable    *_table;                    // 索引表
+    IndexInfo   *_infos;                            // 索引表中的所有索引 (按表中顺序)
+    int         _info_count;
+    IndexInfo   *_info_hash[_INDEX_HASH_SIZE];      // 属性名 -> 索引信息
+    WPDP_String **_names;                           // 所有索引的属性名
     PacketNode  *_p_node_caches[_NODE_MAX_CACHE];   // 结点缓存
     int         _p_node_count;
+    PinnedNode  **_pinned;                          // 固定的内部结点 (按偏移量排序)
+    int         _pinned_count;
+    int64_t     _pinned_memory;                     // 固定的结点占用的内存
     int64_t     _offset_end;                        // 当前文件结尾处的偏移量
+    WPDP_Arena  _scratch;                           // 单次查找中的临时内存
+    WPDP_Pool   _packet_pool;                       // PacketNode 的对象池
+    WPDP_Pool   _node_pools[_NODE_SIZE_CLASSES];    // 各种大小的结点缓冲区的对象池
+    WPDP_Pool   _blob_ex_pools[_NODE_SIZE_CLASSES]; // 各种大小的扩展 blob 的对象池
 };
 
-static int64_t _get_offset_root_from_table(Section *sect, WPDP_String *attr_name);
+static IndexInfo *_get_index_info(Section *sect, WPDP_String *attr_name);
 
-static int _read_table(Section *sect);
+static int _tree_find(Section *sect, IndexInfo *info, WPDP_String *key,
+                      int64_t **offsets_out, int *count_out);
+static int _tree_descend(Section *sect, IndexInfo *info, WPDP_String *key, PacketNode **p_node_out);
+static int _hash_find(Section *sect, IndexInfo *info, WPDP_String *key,
+                      int64_t **offsets_out, int *count_out);
+static int _leaf_collect(Section *sect, IndexInfo *info, PacketNode **p_node_io, WPDP_String *key,
+                         int64_t **offsets_out, int *count_out);
 
-static PacketNode *_get_node(Section *sect, int64_t offset, int64_t offset_parent);
+static int _batch_descend(Section *sect, Batch *batch, int64_t offset, int64_t offset_parent,
+                          int lo, int hi);
+static int _batch_leaf(Section *sect, Batch *batch, PacketNode *p_node, int lo, int hi);
+static int _batch_key_compare_typed(const void *a, const void *b);
+static int _batch_key_compare_string(const void *a, const void *b);
+
+static int _read_table(Section *sect);
+static int _parse_table(Section *sect);
+static int _next_option(StructIndexTable *table, int length, int *pos,
+                        uint8_t *option_out, WPDP_String *name_out, WPDP_String *value_out);
+static int _parse_covered(IndexInfo *info, WPDP_String *value);
+static int _read_filters(Section *sect);
+static int _read_directories(Section *sect);
+
+static int _encode_typed_key(uint8_t key_type, WPDP_String *value, uint64_t *key_out);
+
+static int _get_node(Section *sect, IndexInfo *info, int64_t offset, int64_t offset_parent,
+                     PacketNode **p_node_out);
+static PacketNode *_read_node(Section *sect, IndexInfo *info, int64_t offset, int64_t offset_parent);
+static PacketNode *_alloc_node(Custom *custom, int node_size);
+static void _init_node(Custom *custom, PacketNode *p_node, IndexInfo *info, int64_t offset, int64_t offset_parent);
+static PacketNode *_get_cached_node(Custom *custom, int64_t offset);
+static void _cache_node(Custom *custom, PacketNode *p_node);
+static int _prefetch_leaves(Section *sect, IndexInfo *info, PacketNode *p_node, int num);
+static void _free_node(Custom *custom, PacketNode *p_node);
+static int _node_size_class(int node_size);
+static void _evict_nodes(Custom *custom, int num_keep);
+
+static int _pinned_node_size(PacketNode *p_node);
+static PinnedNode *_pin_node(PacketNode *p_node);
+static PinnedNode *_get_pinned_node(Section *sect, int64_t offset);
+static int _pinned_node_compare(const void *a, const void *b);
+static int64_t _pinned_node_lookup(PinnedNode *pinned, WPDP_String *key);
 
 static int _binary_search_leftmost(PacketNode *p_node, WPDP_String *desired, bool for_lookup);
+static int _typed_search_leftmost(PacketNode *p_node, uint64_t desired, bool for_lookup);
 
 static int _key_compare(PacketNode *p_node, int index, WPDP_String *key);
-static WPDP_String *_get_element_key(PacketNode *p_node, int index);
+static void _get_element_key(PacketNode *p_node, int index, WPDP_String *key_out);
 static int64_t _get_element_value(PacketNode *p_node, int index);
+static int64_t _get_child_count(PacketNode *p_node, int index);
+static int _node_bound(PacketNode *p_node, WPDP_String *key, bool upper);
+
+static int _prepare_key(IndexInfo *info, WPDP_String *value, WPDP_String *key_out, uint64_t *typed_out);
+static int _get_counted_index_info(Section *sect, WPDP_String *attr_name, IndexInfo **info_out);
+static int _tree_rank(Section *sect, IndexInfo *info, WPDP_String *key, bool inclusive, int64_t *rank_out);
+static int _tree_select(Section *sect, IndexInfo *info, int64_t rank, PacketNode **p_node_out, int *pos_out);
+
+static int _offsets_reserve(int64_t **offsets, int64_t count_min, int *capacity);
+static int _offsets_append(int64_t **offsets, int *count, int *capacity, int64_t offset);
+static int _offsets_append_element(PacketNode *p_node, int index,
+                                   int64_t **offsets, int *count, int *capacity);
 
 /**
  * 构造函数
@@ -85,6 +276,20 @@ int section_indexes_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect
 
     sect->custom = wpdp_new_zero(Custom, 1);
     ((Custom *)sect->custom)->_p_node_count = 0;
+    wpdp_arena_init(&((Custom *)sect->custom)->_scratch, 0);
+
+    Custom *custom = (Custom *)sect->custom;
+    int i;
+
+    wpdp_pool_init(&custom->_packet_pool, (int)sizeof(PacketNode), (int)sizeof(void *), _NODE_MAX_CACHE / 4,
+                   WPDP_MEMORY_NODE_CACHE);
+    for (i = 0; i < _NODE_SIZE_CLASSES; i++) {
+        int node_size = NODE_BLOCK_SIZE_MIN << i;
+        wpdp_pool_init(&custom->_node_pools[i], node_size, _NODE_ALIGNMENT, _POOL_SLAB_OBJECTS,
+                       WPDP_MEMORY_NODE_CACHE);
+        wpdp_pool_init(&custom->_blob_ex_pools[i], NODE_DATA_SIZE_EXPANDED_OF(node_size),
+                       _BLOB_EX_ALIGNMENT, _POOL_SLAB_OBJECTS, WPDP_MEMORY_NODE_CACHE);
+    }
 
     rc = _read_table(sect);
     RETURN_VAL_IF_NON_ZERO(rc);
@@ -99,6 +304,60 @@ int section_indexes_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect
     return RETURN_CODE(WPDP_OK);
 }
 
+/**
+ * 关闭索引区域，释放所有缓存与索引信息
+ */
+void section_indexes_close(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+    int i;
+
+    _evict_nodes(custom, 0);
+
+    for (i = 0; i < custom->_pinned_count; i++) {
+        wpdp_free(custom->_pinned[i]);
+    }
+    wpdp_free(custom->_pinned);
+    wpdp_memory_uncharge(WPDP_MEMORY_NODE_CACHE, custom->_pinned_memory);
+
+    for (i = 0; i < custom->_info_count; i++) {
+        wpdp_free(custom->_infos[i].covered);
+        wpdp_free(custom->_infos[i].filter);
+        wpdp_free(custom->_infos[i].directory);
+    }
+    wpdp_free(custom->_infos);
+    wpdp_free(custom->_names);
+    wpdp_free(custom->_table);
+
+    wpdp_arena_destroy(&custom->_scratch);
+    wpdp_pool_destroy(&custom->_packet_pool);
+    for (i = 0; i < _NODE_SIZE_CLASSES; i++) {
+        wpdp_pool_destroy(&custom->_node_pools[i]);
+        wpdp_pool_destroy(&custom->_blob_ex_pools[i]);
+    }
+
+    wpdp_free(custom);
+    section_free(sect);
+}
+
+/**
+ * 释放结点缓存与临时内存 (固定的结点保留)
+ *
+ * 淘汰全部结点后各对象池中没有使用中的对象，把对象池的大块也交还给系统
+ */
+void section_indexes_shrink(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+    int i;
+
+    _evict_nodes(custom, 0);
+    wpdp_arena_destroy(&custom->_scratch);
+
+    wpdp_pool_trim(&custom->_packet_pool);
+    for (i = 0; i < _NODE_SIZE_CLASSES; i++) {
+        wpdp_pool_trim(&custom->_node_pools[i]);
+        wpdp_pool_trim(&custom->_blob_ex_pools[i]);
+    }
+}
+
 int64_t section_indexes_get_section_length(Section *sect) {
     Custom *custom = (Custom*)sect->custom;
 
@@ -106,186 +365,1692 @@ int64_t section_indexes_get_section_length(Section *sect) {
 }
 
 /**
- * 查找符合指定属性值的所有条目元数据的偏移量
+ * 检查指定属性名是否存在索引
+ *
+ * @param attr_name  属性名
+ */
+bool section_indexes_exists(Section *sect, WPDP_String *attr_name) {
+    return (_get_index_info(sect, attr_name) != NULL);
+}
+
+/**
+ * 检查指定属性名的索引是否为分词索引
+ *
+ * @param attr_name  属性名
+ *
+ * @return 指定属性名不存在索引时返回 false
+ */
+bool section_indexes_is_tokenized(Section *sect, WPDP_String *attr_name) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+
+    return (info != NULL && info->tokenized);
+}
+
+/**
+ * 获取分词索引的分词标记
+ *
+ * @param attr_name  属性名
+ * @param flags_out  分词标记 (TOKEN_FLAG_*)
+ *
+ * @return 指定属性名不存在索引时返回 WPDP_ERROR_INVALID_ATTRIBUTE_NAME，
+ *         索引不是分词索引时返回 WPDP_ERROR_BAD_FUNCTION_CALL
+ */
+int section_indexes_get_token_flags(Section *sect, WPDP_String *attr_name, uint8_t *flags_out) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    if (!info->tokenized) {
+        error_set_msg("Index %.*s is not a token index", info->name.len, (char *)info->name.str);
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    *flags_out = info->token_flags;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取所有索引的属性名
+ *
+ * 返回的属性名由索引区域持有，调用者不应修改或释放
  *
- * @param string $attr_name     属性名
- * @param string $attr_value    属性值
+ * @param names_out  属性名数组
+ * @param count_out  索引数量
+ */
+int section_indexes_list(Section *sect, WPDP_String ***names_out, int *count_out) {
+    Custom *custom = (Custom*)sect->custom;
+
+    *names_out = custom->_names;
+    *count_out = custom->_info_count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 把所有 B+ 树索引的根结点与内部结点固定在内存中
+ *
+ * 按层从上到下读取各索引的内部结点 (每层依次处理所有索引)，直到所有内部结点都已
+ * 固定，或者占用的内存将要超过上限。固定的结点不进入结点缓存，也不会被淘汰。
+ * 所有内部结点都被固定时，每次查找最多只需读取一个叶子结点
+ *
+ * @param budget  固定的结点可以占用的内存上限 (字节)
+ */
+int section_indexes_pin(Section *sect, int64_t budget) {
+    Custom *custom = (Custom*)sect->custom;
+
+    typedef struct {
+        IndexInfo   *info;
+        int64_t     offset;
+    } PinTask;
+
+    PinTask *level = wpdp_new_zero(PinTask, custom->_info_count);
+    int level_count = 0, level_capacity = custom->_info_count;
+    PinTask *next = NULL;
+    int next_count = 0, next_capacity = 0;
+    int pinned_capacity = 0;
+    bool full = false;
+    int i, j;
+
+    // 第一层为所有 B+ 树索引的根结点
+    for (i = 0; i < custom->_info_count; i++) {
+        IndexInfo *info = &custom->_infos[i];
+        if (info->type != INDEX_TYPE_HASH && info->ofs_root != 0) {
+            level[level_count].info = info;
+            level[level_count].offset = info->ofs_root;
+            level_count++;
+        }
+    }
+
+    while (level_count > 0 && !full) {
+        IndexInfo *info_leaf_level = NULL;
+        next_count = 0;
+
+        for (i = 0; i < level_count && !full; i++) {
+            // B+ 树是平衡的，同一索引的同一层中只要有一个叶子结点，该层就都是叶子结点
+            if (level[i].info == info_leaf_level) {
+                continue;
+            }
+
+            PacketNode *p_node = _read_node(sect, level[i].info, level[i].offset, OFFSET_PARENT_NO_NEED);
+            if (p_node == NULL) {
+                wpdp_free(level);
+                wpdp_free(next);
+                return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+            }
+
+            if (p_node->node->isLeaf) {
+                info_leaf_level = level[i].info;
+                _free_node(custom, p_node);
+                continue;
+            }
+
+            int size = _pinned_node_size(p_node);
+            if (custom->_pinned_memory + size > budget) {
+                _free_node(custom, p_node);
+                full = true;
+                break;
+            }
+
+            if (custom->_pinned_count == pinned_capacity) {
+                pinned_capacity = (pinned_capacity == 0) ? 16 : pinned_capacity * 2;
+                custom->_pinned = wpdp_realloc(custom->_pinned, (int)sizeof(PinnedNode *) * pinned_capacity);
+            }
+
+            PinnedNode *pinned = _pin_node(p_node);
+            custom->_pinned[custom->_pinned_count] = pinned;
+            custom->_pinned_count++;
+            custom->_pinned_memory += size;
+            wpdp_memory_charge(WPDP_MEMORY_NODE_CACHE, size);
+
+            _free_node(custom, p_node);
+
+            // 子结点进入下一层
+            if (next_count + pinned->count + 1 > next_capacity) {
+                next_capacity = (next_count + pinned->count + 1) * 2;
+                next = wpdp_realloc(next, (int)sizeof(PinTask) * next_capacity);
+            }
+
+            next[next_count].info = level[i].info;
+            next[next_count].offset = pinned->ofs_extra;
+            next_count++;
+
+            for (j = 0; j < pinned->count; j++) {
+                next[next_count].info = level[i].info;
+                next[next_count].offset = pinned->children[j];
+                next_count++;
+            }
+        }
+
+        PinTask *temp = level;
+        int temp_capacity = level_capacity;
+        level = next;
+        level_count = next_count;
+        level_capacity = next_capacity;
+        next = temp;
+        next_capacity = temp_capacity;
+    }
+
+    wpdp_free(level);
+    wpdp_free(next);
+
+    if (custom->_pinned_count > 0) {
+        qsort(custom->_pinned, (size_t)custom->_pinned_count, sizeof(PinnedNode *), _pinned_node_compare);
+    }
+
+    trace("pinned %d nodes, %lld bytes", custom->_pinned_count, custom->_pinned_memory);
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取固定在内存中的结点所占用的内存
+ */
+int64_t section_indexes_get_pinned_memory(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+
+    return custom->_pinned_memory;
+}
+
+/**
+ * 查找符合指定属性值的所有条目元数据的偏移量
  *
- * @return array 返回所有找到的条目元数据的偏移量，未找到任何条目时返回空数组，
- *               指定属性名不存在索引时返回 false
+ * @param attr_name     属性名
+ * @param attr_value    属性值
+ * @param offsets_out   所有找到的条目元数据的偏移量，未找到任何条目时为 NULL
+ * @param count_out     找到的条目数量
  *
- * @throws WPDP_InternalException
+ * @return 指定属性名不存在索引时返回 WPDP_ERROR_INVALID_ATTRIBUTE_NAME
  */
-void *section_indexes_find(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value) {
+int section_indexes_find(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value,
+                         int64_t **offsets_out, int *count_out) {
     // Possible traces:
     // EXTERNAL -> find()
     //
     // So this method NEED to protect the nodes in cache
-/*
-    if (!array_key_exists($attr_name, $this->_table['indexes'])) {
-        return false;
+
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
     }
-*/
 
-    WPDP_String *key = attr_value;
+    WPDP_String key_data;
+    WPDP_String *key = &key_data;
+    uint64_t typed_key_data;
+
+    *offsets_out = NULL;
+    *count_out = 0;
+
+    // 数值类型的索引先把属性值转换为编码后的 8 字节键
+    int rc = _prepare_key(info, attr_value, &key_data, &typed_key_data);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    // 过滤器可以确定不存在的键不需要读取任何结点
+    if (info->filter != NULL && !filter_may_contain(info->filter, key)) {
+        return WPDP_OK;
+    }
+
+    switch (info->type) {
+        case INDEX_TYPE_HASH:
+            return _hash_find(sect, info, key, offsets_out, count_out);
+        default:
+            return _tree_find(sect, info, key, offsets_out, count_out);
+    }
+}
+
+/**
+ * 在 B+ 树索引中查找指定键的所有值
+ */
+static int _tree_find(Section *sect, IndexInfo *info, WPDP_String *key,
+                      int64_t **offsets_out, int *count_out) {
+    PacketNode *p_node;
+    int rc = _tree_descend(sect, info, key, &p_node);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    return _leaf_collect(sect, info, &p_node, key, offsets_out, count_out);
+}
 
-    int64_t offset = 0; // $this->_table['indexes'][$attr_name]['ofsRoot'];
+/**
+ * 从根结点向下找到指定键所在的叶子结点
+ */
+static int _tree_descend(Section *sect, IndexInfo *info, WPDP_String *key, PacketNode **p_node_out) {
+    int64_t offset = info->ofs_root;
+    int64_t offset_parent = OFFSET_PARENT_NULL;
+    PinnedNode *pinned;
+    PacketNode *p_node;
+    int rc;
+
+    // 先经过固定在内存中的上层结点，不需要读取文件
+    while ((pinned = _get_pinned_node(sect, offset)) != NULL) {
+        offset_parent = offset;
+        offset = _pinned_node_lookup(pinned, key);
+    }
 
-    PacketNode *p_node = _get_node(sect, offset, OFFSET_PARENT_NULL);
+    rc = _get_node(sect, info, offset, offset_parent, &p_node);
+    RETURN_VAL_IF_NON_ZERO(rc);
 
     while (!p_node->node->isLeaf) {
         int pos = _binary_search_leftmost(p_node, key, true);
         if (pos == -1) {
             offset = p_node->node->ofsExtra;
         } else {
-//            offset = node['elements'][$pos]['value'];
+            offset = _get_element_value(p_node, pos);
         }
 
-//        p_node = _get_node(offset, $node['_ofsSelf']);
+        rc = _get_node(sect, info, offset, p_node->offset_self, &p_node);
+        RETURN_VAL_IF_NON_ZERO(rc);
     }
 
+    *p_node_out = p_node;
+
+    return WPDP_OK;
+}
+
+/**
+ * 从叶子结点开始沿叶子结点链表取得指定键的所有值
+ *
+ * @param p_node_io    开始查找的叶子结点，返回时为查找结束时所在的叶子结点
+ * @param key          键
+ * @param offsets_out  找到的所有值，未找到时不改变
+ * @param count_out    找到的值的数量
+ *
+ * @return 读取后续的叶子结点失败时返回错误，此时 p_node_io 不变
+ */
+static int _leaf_collect(Section *sect, IndexInfo *info, PacketNode **p_node_io, WPDP_String *key,
+                         int64_t **offsets_out, int *count_out) {
+    Custom *custom = (Custom*)sect->custom;
+    PacketNode *p_node = *p_node_io;
     int pos = _binary_search_leftmost(p_node, key, false);
+    int rc;
 
     if (pos == _BINARY_SEARCH_NOT_FOUND) {
-//        return array();
+        return WPDP_OK;
     }
 
-//    offsets = array();
-/*
-    while ($node['elements'][$pos]['key'] == $key) {
-        $offsets[] = $node['elements'][$pos]['value'];
-
-        if ($pos < count($node['elements']) - 1) {
-            $pos++;
-        } elseif ($node['ofsExtra'] != 0) {
-            $node =& $this->_getNode($node['ofsExtra'], $this->_node_parents[$node['_ofsSelf']]);
-            $pos = 0;
+    int capacity = 0;
+    int num_crossed = 0;
+    int num_prefetch = _PREFETCH_MIN;
+
+    while (_key_compare(p_node, pos, key) == 0) {
+        rc = _offsets_append_element(p_node, pos, offsets_out, count_out, &capacity);
+        RETURN_VAL_IF_NON_ZERO(rc);
+
+        if (pos < p_node->node->numElement - 1) {
+            pos++;
+        } else if (p_node->node->ofsExtra != 0) {
+            // 预读时当前结点可能被淘汰，先取出需要的值
+            int64_t offset_next = p_node->node->ofsExtra;
+            int64_t offset_parent = p_node->offset_parent;
+
+            // 经过的叶子结点较多时，预读之后相邻的叶子结点，并逐渐增加预读的数量
+            num_crossed++;
+            if (num_crossed >= _PREFETCH_AFTER
+                && _get_cached_node(custom, offset_next) == NULL) {
+                if (_prefetch_leaves(sect, info, p_node, num_prefetch) > 0) {
+                    num_prefetch = (num_prefetch * 2 < _PREFETCH_MAX) ? num_prefetch * 2 : _PREFETCH_MAX;
+                } else {
+                    num_prefetch = _PREFETCH_MIN;
+                }
+            }
+            rc = _get_node(sect, info, offset_next, offset_parent, &p_node);
+            RETURN_VAL_IF_NON_ZERO(rc);
+            pos = 0;
         } else {
             break;
         }
     }
 
-    return $offsets;
-*/
+    *p_node_io = p_node;
 
-    return NULL;
+    return WPDP_OK;
 }
 
-static int64_t _get_offset_root_from_table(Section *sect, WPDP_String *attr_name) {
+/**
+ * 在哈希索引中查找指定键的所有值
+ *
+ * 哈希索引为可扩展哈希 (extendible hashing)。目录在打开时已读入内存，按键的
+ * 64 位哈希值的低 globalDepth 位选择桶。桶与 B+ 树的叶子结点格式相同，桶内的
+ * 元素按键排序，桶溢出时由 ofsExtra 链接到溢出桶。所以一次查找通常只需要
+ * 读取一个结点。
+ *
+ * 溢出桶链的长度不会超过索引区域中的结点数，超过时说明链中有环
+ *
+ * @return 溢出桶链中有环时返回 WPDP_ERROR_FILE_BROKEN
+ */
+static int _hash_find(Section *sect, IndexInfo *info, WPDP_String *key,
+                      int64_t **offsets_out, int *count_out) {
     Custom *custom = (Custom*)sect->custom;
-    StructIndexTable *table = custom->_table;
+    StructHashDirectory *directory = info->directory;
+    uint64_t mask = ((uint64_t)1 << directory->globalDepth) - 1;
+    int64_t offset = ((int64_t *)directory->blob)[wpdp_string_hash64(key) & mask];
+    int64_t hops_left = custom->_offset_end / info->node_size + 1;
+    int capacity = 0;
+    int rc;
+
+    while (offset != 0) {
+        PacketNode *p_node;
+
+        if (--hops_left < 0) {
+            error_set_msg("Overflow bucket chain of index %.*s is too long", info->name.len, (char *)info->name.str);
+            return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        }
 
-    int length = table->lenActual - (int32_t)sizeof(StructIndexTable);
+        rc = _get_node(sect, info, offset, OFFSET_PARENT_NO_NEED, &p_node);
+        RETURN_VAL_IF_NON_ZERO(rc);
 
-    int pos = 0;
-    while (pos < length) {
-        if (*((uint8_t *)(table->blob + pos)) != INDEX_SIGNATURE) {
-            return -1;
+        int pos = _binary_search_leftmost(p_node, key, false);
+        if (pos != _BINARY_SEARCH_NOT_FOUND) {
+            for (; pos < p_node->node->numElement && _key_compare(p_node, pos, key) == 0; pos++) {
+                rc = _offsets_append_element(p_node, pos, offsets_out, count_out, &capacity);
+                RETURN_VAL_IF_NON_ZERO(rc);
+            }
         }
-        pos++;
 
-        if (*((uint8_t *)(table->blob + pos)) != INDEX_TYPE_BTREE) {
-            return -1;
+        offset = p_node->node->ofsExtra;
+    }
+
+    return WPDP_OK;
+}
+
+/**
+ * 批量查找多个属性值
+ *
+ * 所有键先排序，然后从根结点开始一起向下查找: 每个结点只读取与查找一次，在结点中
+ * 按所属子结点把键分组，再对每组递归。同一叶子结点中的键依次沿叶子结点链表查找，
+ * 后一个键从前一个键结束的位置继续，不会重复读取已经经过的叶子结点。
+ *
+ * 对每个键调用一次 callback，参数 index 为该键在 keys 中的下标。被过滤器排除的键
+ * 最先回调 (按在 keys 中的顺序)，其余的键按排序后的顺序回调。offsets 只在回调
+ * 期间有效。callback 返回非 0 值时停止查找并返回该值
+ *
+ * @param attr_name  属性名
+ * @param keys       各属性值
+ * @param n          属性值的数量
+ * @param callback   回调函数
+ * @param arg        传递给回调函数的参数
+ *
+ * @return 指定属性名不存在索引时返回 WPDP_ERROR_INVALID_ATTRIBUTE_NAME
+ */
+int section_indexes_find_many(Section *sect, WPDP_String *attr_name, WPDP_String *keys, int n,
+                              WPDP_QueryCallback callback, void *arg) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    Custom *custom = (Custom *)sect->custom;
+    WPDP_ArenaMark mark = wpdp_arena_mark(&custom->_scratch);
+    Batch batch;
+    int count = 0;
+    int i, rc = WPDP_OK;
+
+    memset(&batch, 0, sizeof(Batch));
+    batch.info = info;
+    batch.keys = wpdp_arena_new_zero(&custom->_scratch, BatchKey, n);
+    batch.callback = callback;
+    batch.arg = arg;
+
+    for (i = 0; i < n; i++) {
+        BatchKey *bkey = &batch.keys[count];
+
+        bkey->key = keys[i];
+        bkey->index = i;
+
+        if (info->key_type != KEY_TYPE_STRING) {
+            rc = _encode_typed_key(info->key_type, &keys[i], &bkey->typed);
+            if (rc != WPDP_OK) {
+                wpdp_arena_release(&custom->_scratch, mark);
+                return rc;
+            }
+            wpdp_string_init(&bkey->key, &bkey->typed, (int)sizeof(uint64_t));
         }
-        pos++;
 
-        int len = *((uint8_t *)(table->blob + pos));
-        pos++;
+        // 过滤器可以确定不存在的键直接回调，不参与查找
+        if (info->filter != NULL && !filter_may_contain(info->filter, &bkey->key)) {
+            rc = callback(arg, i, NULL, 0);
+            if (rc != WPDP_OK) {
+                wpdp_arena_release(&custom->_scratch, mark);
+                return rc;
+            }
+            continue;
+        }
 
-        WPDP_String *name = wpdp_string_direct(table->blob + pos, len);
-        pos += len;
+        count++;
+    }
 
-        if (wpdp_string_compare(name, attr_name) == 0) {
-            int64_t offset = *((int64_t *)(table->blob + pos));
-            return offset;
+    if (count > 0) {
+        // 数值类型的键内联保存在 key 中，排序时可以直接移动
+        qsort(batch.keys, (size_t)count, sizeof(BatchKey),
+              (info->key_type != KEY_TYPE_STRING) ? _batch_key_compare_typed : _batch_key_compare_string);
+
+        if (info->type == INDEX_TYPE_HASH) {
+            // 哈希索引的每个键只需读取一个桶，逐个查找即可
+            for (i = 0; i < count && rc == WPDP_OK; i++) {
+                int64_t *offsets = NULL;
+                int num = 0;
+                rc = _hash_find(sect, info, &batch.keys[i].key, &offsets, &num);
+                if (rc == WPDP_OK) {
+                    rc = callback(arg, batch.keys[i].index, offsets, num);
+                }
+                wpdp_free(offsets);
+            }
+        } else {
+            rc = _batch_descend(sect, &batch, info->ofs_root, OFFSET_PARENT_NULL, 0, count);
         }
-        pos += 8;
     }
 
-    return -1;
+    wpdp_free(batch.offsets);
+    wpdp_arena_release(&custom->_scratch, mark);
+
+    return rc;
 }
 
 /**
- * 读取索引表
+ * 批量查找中从指定结点向下查找键 [lo, hi)
  */
-static int _read_table(Section *sect) {
-    Custom *custom = (Custom*)sect->custom;
+static int _batch_descend(Section *sect, Batch *batch, int64_t offset, int64_t offset_parent,
+                          int lo, int hi) {
+    PinnedNode *pinned = _get_pinned_node(sect, offset);
+    PacketNode *p_node = NULL;
+    int i, rc;
+
+    if (pinned != NULL) {
+        for (i = lo; i < hi; i++) {
+            batch->keys[i].child = _pinned_node_lookup(pinned, &batch->keys[i].key);
+        }
+    } else {
+        rc = _get_node(sect, batch->info, offset, offset_parent, &p_node);
+        RETURN_VAL_IF_NON_ZERO(rc);
 
-    section_seek(sect, sect->_section->ofsTable, SEEK_SET, _RELATIVE);
-    struct_read_index_table(sect->_stream, &custom->_table, false);
+        if (p_node->node->isLeaf) {
+            return _batch_leaf(sect, batch, p_node, lo, hi);
+        }
 
-    return RETURN_CODE(WPDP_OK);
+        for (i = lo; i < hi; i++) {
+            int pos = _binary_search_leftmost(p_node, &batch->keys[i].key, true);
+            batch->keys[i].child = (pos == -1) ? p_node->node->ofsExtra
+                                               : _get_element_value(p_node, pos);
+        }
+    }
+
+    // 递归时当前结点可能被从缓存中淘汰，此后只使用已经取出的子结点偏移量
+    for (i = lo; i < hi; ) {
+        int end = i + 1;
+        while (end < hi && batch->keys[end].child == batch->keys[i].child) {
+            end++;
+        }
+
+        rc = _batch_descend(sect, batch, batch->keys[i].child, offset, i, end);
+        RETURN_VAL_IF_NON_ZERO(rc);
+
+        i = end;
+    }
+
+    return WPDP_OK;
 }
 
 /**
- * 获取一个结点
- *
- * $offset_parent 参数为 null 时表示要获取的结点是根结点。
- * $offset_parent 参数为缺省值 -1 时表示不需要设置父结点的偏移量信息。
- *
- * 该方法可能会从缓存中去除某些结点
- *
- * @param integer $offset         要获取结点的偏移量 (相对)
- * @param integer $offset_parent  要获取结点父结点的偏移量 (可选)
+ * 批量查找中在叶子结点及其后的叶子结点中查找键 [lo, hi)
  *
- * @return array 结点
+ * 回调函数中可能对同一数据堆进行查询而使当前结点被从缓存中淘汰，所以每次回调后
+ * 按偏移量重新获取当前结点
  */
-static PacketNode *_get_node(Section *sect, int64_t offset, int64_t offset_parent) {
-    Custom *custom = (Custom*)sect->custom;
+static int _batch_leaf(Section *sect, Batch *batch, PacketNode *p_node, int lo, int hi) {
+    int i, rc;
 
-    // 只有在 _splitNode_GetParentNode() 方法中，当一个结点不是根结点时，获取其父结点才会使用
-    // $offset_parent = OFFSET_PARENT_NO_NEED 的缺省参数，不设置该结点父结点的偏移量信息。
-    //
-    // index() -- 已对结点进行保护
-    // -> _treeInsert() -- 只有在插入元素后结点溢出时才调用分裂结点的方法
-    //   -> _splitNode() -- 需要调用获取父结点的方法
-    //     -> _splitNode_GetParentNode() -- 该方法只由 _splitNode() 方法调用
-    //
-    // _treeInsert() 方法在进行向 B+ 树中插入元素的操作时是从树的根结点依次向下进行的，中间
-    // 途径结点的父结点偏移量都会被保存下来。而整个过程中涉及到的结点不会被从缓存中除去，所以
-    // 在这种情况下使用该缺省参数是安全的。
-//    assert((offset_parent != OFFSET_PARENT_NO_NEED) || array_key_exists($offset, $this->_node_parents));
+    for (i = lo; i < hi; i++) {
+        BatchKey *bkey = &batch->keys[i];
 
-    trace("offset = 0x%llX, parent = 0x%llX", offset, offset_parent);
+        // 重复的键使用上一个键的结果
+        if (i == 0 || wpdp_string_compare(&batch->keys[i - 1].key, &bkey->key) != 0) {
+            wpdp_free(batch->offsets);
+            batch->offsets = NULL;
+            batch->count = 0;
 
-    int i;
-    for (i = 0; i < custom->_p_node_count; i++) {
-        if (custom->_p_node_caches[i]->offset_self == offset) {
-            trace("found in cache");
-            return custom->_p_node_caches[i];
+            // 前一个键的所有元素都在当前键之前，所以从前一个键结束的叶子结点继续
+            rc = _leaf_collect(sect, batch->info, &p_node, &bkey->key, &batch->offsets, &batch->count);
+            RETURN_VAL_IF_NON_ZERO(rc);
         }
-    }
 
-/*
-    if (offset_parent != OFFSET_PARENT_NO_NEED) {
-        $this->_node_parents[$offset] = $offset_parent;
-    }
-*/
+        int64_t offset = p_node->offset_self;
+        int64_t offset_parent = p_node->offset_parent;
 
-    trace("read from file");
+        rc = batch->callback(batch->arg, bkey->index, batch->offsets, batch->count);
+        RETURN_VAL_IF_NON_ZERO(rc);
 
-    section_seek(sect, offset, SEEK_SET, _RELATIVE);
+        if (i + 1 < hi) {
+            rc = _get_node(sect, batch->info, offset, offset_parent, &p_node);
+            RETURN_VAL_IF_NON_ZERO(rc);
+        }
+    }
 
-    PacketNode *p_node = wpdp_new_zero(PacketNode, 1);
-    struct_read_node(sect->_stream, &p_node->node);
-    p_node->offset_self = offset;
-    p_node->offset_parent = offset_parent;
+    return WPDP_OK;
+}
 
-    void *ptr_last_elem = _ext_elem_ptr(p_node, p_node->node->numElement - 1);
-    int distance_last_key = _com_elem_key_str_distance(ptr_last_elem);
-    memcpy(p_node->blob_ex, p_node->node->blob, (size_t)(ELEMENT_SIZE * p_node->node->numElement));
-    memcpy(_ext_elem_key_str_ptr(p_node, distance_last_key),
-        _std_elem_key_str_ptr(p_node, distance_last_key),
-        (size_t)distance_last_key);
+/**
+ * 按编码后的值比较两个数值类型的键 (用于 qsort)
+ */
+static int _batch_key_compare_typed(const void *a, const void *b) {
+    uint64_t typed_a = ((const BatchKey *)a)->typed;
+    uint64_t typed_b = ((const BatchKey *)b)->typed;
 
-    p_node->distance_furthest_key = distance_last_key;
+    return (typed_a > typed_b) - (typed_a < typed_b);
+}
+
+/**
+ * 按键字符串比较两个键 (用于 qsort)
+ */
+static int _batch_key_compare_string(const void *a, const void *b) {
+    return wpdp_string_compare(&((BatchKey *)a)->key, &((BatchKey *)b)->key);
+}
+
+/**
+ * 获取覆盖索引的叶子结点中附带的属性名
+ *
+ * @param attr_name  属性名
+ * @param names_out  附带的各属性名 (由索引区域持有，调用者不应修改或释放)
+ * @param count_out  附带的属性数量，不是覆盖索引时为 0
+ */
+int section_indexes_get_covered(Section *sect, WPDP_String *attr_name, WPDP_String **names_out, int *count_out) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    *names_out = info->covered;
+    *count_out = info->covered_count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 在覆盖索引中查找指定属性值，直接从叶子结点中取得附带的属性值
+ *
+ * 覆盖索引的叶子结点中，每个元素的键字符串之后依次保存附带的各属性值 (uint8 长度
+ * + 值)，所以不需要读取条目的元数据。对每个找到的元素调用一次 callback，values
+ * 与 section_indexes_get_covered() 返回的属性名一一对应，只在回调期间有效。
+ * 回调函数中不能对同一数据堆进行查询
+ *
+ * @param attr_name   属性名
+ * @param attr_value  属性值
+ * @param callback    回调函数，返回非 0 值时停止查找并返回该值
+ * @param arg         传递给回调函数的参数
+ */
+int section_indexes_find_covering(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value,
+                                  WPDP_CoveringCallback callback, void *arg) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    // 只有字符串类型的 B+ 树索引才有保存附带属性值的键字符串区域
+    if (info->covered_count == 0 || info->type == INDEX_TYPE_HASH
+        || info->key_type != KEY_TYPE_STRING || info->postings) {
+        error_set_msg("Index %.*s is not a covering index", info->name.len, (char *)info->name.str);
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (info->filter != NULL && !filter_may_contain(info->filter, attr_value)) {
+        return WPDP_OK;
+    }
+
+    PacketNode *p_node;
+    int rc = _tree_descend(sect, info, attr_value, &p_node);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    int pos = _binary_search_leftmost(p_node, attr_value, false);
+    int i;
+
+    if (pos == _BINARY_SEARCH_NOT_FOUND) {
+        return WPDP_OK;
+    }
+
+    Custom *custom = (Custom *)sect->custom;
+    WPDP_ArenaMark mark = wpdp_arena_mark(&custom->_scratch);
+    WPDP_String *values = wpdp_arena_new_zero(&custom->_scratch, WPDP_String, info->covered_count);
+
+    while (_key_compare(p_node, pos, attr_value) == 0) {
+        void *ptr_elem = _ext_elem_ptr(p_node, pos);
+        int distance = _com_elem_key_str_distance(ptr_elem);
+        uint8_t *ptr = _ext_elem_key_str_ptr(p_node, distance);
+        uint8_t *end = _ext_elem_key_str_ptr(p_node, 0);
+
+        // 键字符串与各附带的属性值都必须在结点的键字符串区域之内
+        if (distance <= 0 || distance > p_node->distance_furthest_key) {
+            rc = RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        } else {
+            ptr += 1 + _com_elem_key_str_len(ptr);
+            for (i = 0; i < info->covered_count; i++) {
+                if (ptr >= end || *ptr > end - ptr - 1) {
+                    rc = RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                    break;
+                }
+                values[i] = wpdp_string_view(ptr + 1, *ptr);
+                ptr += 1 + values[i].len;
+            }
+        }
+        if (rc != WPDP_OK) {
+            error_set_msg("Covered values of element %d exceed the node at 0x%llX",
+                          pos, (long long)p_node->offset_self);
+            break;
+        }
+
+        rc = callback(arg, _get_element_value(p_node, pos), values, info->covered_count);
+        if (rc != WPDP_OK) {
+            break;
+        }
+
+        if (pos < p_node->node->numElement - 1) {
+            pos++;
+        } else if (p_node->node->ofsExtra != 0) {
+            rc = _get_node(sect, info, p_node->node->ofsExtra, p_node->offset_parent, &p_node);
+            if (rc != WPDP_OK) {
+                break;
+            }
+            pos = 0;
+        } else {
+            break;
+        }
+    }
+
+    wpdp_arena_release(&custom->_scratch, mark);
+
+    return rc;
+}
+
+/**
+ * 统计键在指定范围内的元素数量
+ *
+ * 只能用于计数的 B+ 树索引 (INDEX_OPTION_COUNTED)。分别求出两个边界的排名后相减，
+ * 只需从根结点向下经过两条路径，不需要读取范围内的叶子结点
+ *
+ * @param attr_name  属性名
+ * @param lo         键的下界 (含)，为 NULL 时无下界
+ * @param hi         键的上界 (含)，为 NULL 时无上界
+ * @param count_out  元素数量
+ */
+int section_indexes_count(Section *sect, WPDP_String *attr_name, WPDP_String *lo, WPDP_String *hi,
+                          int64_t *count_out) {
+    IndexInfo *info;
+    WPDP_String key;
+    uint64_t typed;
+    int64_t rank_lo = 0, rank_hi;
+    int rc;
+
+    rc = _get_counted_index_info(sect, attr_name, &info);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    if (lo != NULL) {
+        rc = _prepare_key(info, lo, &key, &typed);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        rc = _tree_rank(sect, info, &key, false, &rank_lo);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    if (hi != NULL) {
+        rc = _prepare_key(info, hi, &key, &typed);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        rc = _tree_rank(sect, info, &key, true, &rank_hi);
+    } else {
+        rc = _tree_rank(sect, info, NULL, true, &rank_hi);
+    }
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *count_out = (rank_hi > rank_lo) ? (rank_hi - rank_lo) : 0;
+
+    return WPDP_OK;
+}
+
+/**
+ * 按键的顺序取得指定范围内的一页元素的值
+ *
+ * 只能用于计数的 B+ 树索引。先求出下界的排名，再按子树的元素数量直接定位到第
+ * skip 个元素所在的叶子结点，跳过的元素不需要读取
+ *
+ * @param attr_name    属性名
+ * @param lo           键的下界 (含)，为 NULL 时无下界
+ * @param hi           键的上界 (含)，为 NULL 时无上界
+ * @param skip         跳过的元素数量
+ * @param limit        最多取得的元素数量
+ * @param offsets_out  各元素的值 (条目元数据的偏移量，按键排序)，没有元素时为 NULL
+ * @param count_out    取得的元素数量
+ */
+int section_indexes_select(Section *sect, WPDP_String *attr_name, WPDP_String *lo, WPDP_String *hi,
+                           int64_t skip, int limit, int64_t **offsets_out, int *count_out) {
+    assert(skip >= 0 && limit >= 0);
+
+    IndexInfo *info;
+    WPDP_String key;
+    uint64_t typed;
+    int64_t rank_lo = 0, rank_hi;
+    int capacity = 0;
+    int pos, rc;
+
+    *offsets_out = NULL;
+    *count_out = 0;
+
+    rc = _get_counted_index_info(sect, attr_name, &info);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    if (lo != NULL) {
+        rc = _prepare_key(info, lo, &key, &typed);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        rc = _tree_rank(sect, info, &key, false, &rank_lo);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    if (hi != NULL) {
+        rc = _prepare_key(info, hi, &key, &typed);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        rc = _tree_rank(sect, info, &key, true, &rank_hi);
+    } else {
+        rc = _tree_rank(sect, info, NULL, true, &rank_hi);
+    }
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    int64_t first = rank_lo + skip;
+    int64_t num = rank_hi - first;
+    if (num <= 0 || limit == 0) {
+        return WPDP_OK;
+    }
+    if (num > limit) {
+        num = limit;
+    }
+
+    PacketNode *p_node;
+    rc = _tree_select(sect, info, first, &p_node, &pos);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    while (p_node != NULL && *count_out < num) {
+        rc = _offsets_append(offsets_out, count_out, &capacity, _get_element_value(p_node, pos));
+        if (rc != WPDP_OK) {
+            break;
+        }
+
+        if (pos < p_node->node->numElement - 1) {
+            pos++;
+        } else if (p_node->node->ofsExtra != 0) {
+            rc = _get_node(sect, info, p_node->node->ofsExtra, p_node->offset_parent, &p_node);
+            if (rc != WPDP_OK) {
+                break;
+            }
+            pos = 0;
+        } else {
+            break;
+        }
+    }
+
+    if (rc != WPDP_OK) {
+        wpdp_free(*offsets_out);
+        *offsets_out = NULL;
+        *count_out = 0;
+    }
+
+    return rc;
+}
+
+/**
+ * 获取计数的 B+ 树索引的信息
+ */
+static int _get_counted_index_info(Section *sect, WPDP_String *attr_name, IndexInfo **info_out) {
+    IndexInfo *info = _get_index_info(sect, attr_name);
+    if (info == NULL) {
+        return WPDP_ERROR_INVALID_ATTRIBUTE_NAME;
+    }
+
+    // 压缩的偏移量列表中一个元素对应多个值，子树的元素数量不是值的数量
+    if (info->type == INDEX_TYPE_HASH || !info->counted || info->postings) {
+        error_set_msg("Index %.*s is not a counted B+ tree", info->name.len, (char *)info->name.str);
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    *info_out = info;
+
+    return WPDP_OK;
+}
+
+/**
+ * 计算键小于 (或不大于) 指定键的元素数量
+ *
+ * 普通结点中第 i 个子树的键都不小于第 i 个键，且不大于第 i + 1 个键。下界选择最后
+ * 一个键小于指定键的子树，上界选择最后一个键不大于指定键的子树，之前的子树中的
+ * 元素全部计入
+ *
+ * @param key        键，为 NULL 时返回所有元素的数量
+ * @param inclusive  是否计入与指定键相等的元素
+ * @param rank_out   元素数量
+ */
+static int _tree_rank(Section *sect, IndexInfo *info, WPDP_String *key, bool inclusive, int64_t *rank_out) {
+    PacketNode *p_node;
+    int64_t rank = 0;
+    int i;
+
+    int rc = _get_node(sect, info, info->ofs_root, OFFSET_PARENT_NULL, &p_node);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    while (!p_node->node->isLeaf) {
+        int bound = (key == NULL) ? p_node->node->numElement : _node_bound(p_node, key, inclusive);
+        int64_t offset;
+
+        if (bound == 0) {
+            offset = p_node->node->ofsExtra;
+        } else {
+            rank += _get_child_count(p_node, -1);
+            for (i = 0; i < bound - 1; i++) {
+                rank += _get_child_count(p_node, i);
+            }
+            offset = _get_element_value(p_node, bound - 1);
+        }
+
+        rc = _get_node(sect, info, offset, p_node->offset_self, &p_node);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    if (key == NULL) {
+        *rank_out = rank + p_node->node->numElement;
+    } else {
+        *rank_out = rank + _node_bound(p_node, key, inclusive);
+    }
+
+    return WPDP_OK;
+}
+
+/**
+ * 按子树的元素数量找到排名为 rank 的元素 (从 0 开始)
+ *
+ * @param rank        排名
+ * @param p_node_out  该元素所在的叶子结点，rank 超出范围时为 NULL
+ * @param pos_out     该元素在叶子结点中的位置
+ */
+static int _tree_select(Section *sect, IndexInfo *info, int64_t rank, PacketNode **p_node_out, int *pos_out) {
+    PacketNode *p_node;
+    int i;
+
+    *p_node_out = NULL;
+
+    int rc = _get_node(sect, info, info->ofs_root, OFFSET_PARENT_NULL, &p_node);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    while (!p_node->node->isLeaf) {
+        int64_t offset = 0;
+        int64_t count = _get_child_count(p_node, -1);
+
+        if (rank < count) {
+            offset = p_node->node->ofsExtra;
+        } else {
+            rank -= count;
+            for (i = 0; i < p_node->node->numElement; i++) {
+                count = _get_child_count(p_node, i);
+                if (rank < count) {
+                    offset = _get_element_value(p_node, i);
+                    break;
+                }
+                rank -= count;
+            }
+        }
+
+        if (offset == 0) {
+            return WPDP_OK;
+        }
+
+        rc = _get_node(sect, info, offset, p_node->offset_self, &p_node);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    if (rank >= p_node->node->numElement) {
+        return WPDP_OK;
+    }
+
+    *p_node_out = p_node;
+    *pos_out = (int)rank;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取指定属性名的索引信息
+ *
+ * @param attr_name  属性名
+ *
+ * @return 索引信息，指定属性名不存在索引时返回 NULL
+ */
+static IndexInfo *_get_index_info(Section *sect, WPDP_String *attr_name) {
+    Custom *custom = (Custom*)sect->custom;
+    uint32_t hash = wpdp_string_hash(attr_name);
+    IndexInfo *info;
+
+    for (info = custom->_info_hash[hash % _INDEX_HASH_SIZE]; info != NULL; info = info->next) {
+        if (info->hash == hash && wpdp_string_compare(&info->name, attr_name) == 0) {
+            return info;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * 读取索引表
+ */
+static int _read_table(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+
+    int rc;
+
+    section_seek(sect, sect->_section->ofsTable, SEEK_SET, _RELATIVE);
+    rc = struct_read_index_table(sect->_stream, &custom->_table, false);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = _parse_table(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = _read_filters(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = _read_directories(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+/**
+ * 解析索引表
+ *
+ * 索引表只在打开时解析一次，之后按属性名查找索引时只需查询哈希表。
+ * 属性名直接指向索引表中的数据，不为每个索引单独分配字符串。
+ *
+ * 索引表中每个索引的格式为:
+ *   signature (uint8) | type (uint8) | lenName (uint8) | name | ofsRoot (int64)
+ *
+ * 索引选项 (INDEX_OPTION_SIGNATURE) 在所有索引解析完成后再应用到同名的索引上
+ */
+static int _parse_table(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+    StructIndexTable *table = custom->_table;
+
+    int length = table->lenActual - (int32_t)sizeof(StructIndexTable);
+    int capacity = 0;
+    int i, rc;
+
+    uint8_t option;
+    WPDP_String name, value;
+
+    custom->_infos = NULL;
+    custom->_info_count = 0;
+
+    int pos = 0;
+    while (pos < length) {
+        if (table->blob[pos] == INDEX_OPTION_SIGNATURE) {
+            rc = _next_option(table, length, &pos, &option, &name, &value);
+            RETURN_VAL_IF_NON_ZERO(rc);
+            continue;
+        }
+
+        if (pos + 3 > length || table->blob[pos] != INDEX_SIGNATURE) {
+            error_set_msg("Broken index table at 0x%X", pos);
+            return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        }
+        pos++;
+
+        uint8_t type = table->blob[pos];
+        if (type != INDEX_TYPE_BTREE && type != INDEX_TYPE_HASH) {
+            error_set_msg("Unsupported index type 0x%X", type);
+            return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        }
+        pos++;
+
+        int len = table->blob[pos];
+        pos++;
+
+        if (pos + len + 8 > length) {
+            error_set_msg("Broken index table at 0x%X", pos);
+            return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        }
+
+        if (custom->_info_count == capacity) {
+            capacity = (capacity == 0) ? 8 : capacity * 2;
+            custom->_infos = wpdp_realloc(custom->_infos, (int)sizeof(IndexInfo) * capacity);
+        }
+
+        IndexInfo *info = &custom->_infos[custom->_info_count];
+        memset(info, 0, sizeof(IndexInfo));
+        info->name = wpdp_string_view(table->blob + pos, len);
+        info->hash = wpdp_string_hash(&info->name);
+        info->type = type;
+        info->node_size = NODE_BLOCK_SIZE;
+        pos += len;
+
+        info->ofs_root = *((int64_t *)(table->blob + pos));
+        pos += 8;
+
+        custom->_info_count++;
+    }
+
+    // 数组的大小已经确定，此时再建立哈希表与属性名列表
+    memset(custom->_info_hash, 0, sizeof(custom->_info_hash));
+    custom->_names = wpdp_new_zero(WPDP_String *, custom->_info_count);
+
+    for (i = 0; i < custom->_info_count; i++) {
+        IndexInfo *info = &custom->_infos[i];
+        // 同名的索引只保留第一个
+        if (_get_index_info(sect, &info->name) == NULL) {
+            IndexInfo **bucket = &custom->_info_hash[info->hash % _INDEX_HASH_SIZE];
+            info->next = *bucket;
+            *bucket = info;
+        }
+        custom->_names[i] = &info->name;
+    }
+
+    // 第一遍已经检查过格式，这里只需跳过索引信息
+    pos = 0;
+    while (pos < length) {
+        if (table->blob[pos] == INDEX_SIGNATURE) {
+            pos += 3 + table->blob[pos + 2] + 8;
+            continue;
+        }
+
+        _next_option(table, length, &pos, &option, &name, &value);
+
+        IndexInfo *info = _get_index_info(sect, &name);
+        if (info == NULL) {
+            continue;
+        }
+
+        switch (option) {
+            case INDEX_OPTION_KEY_TYPE:
+                if (value.len != 1 || !(IN_ARRAY_4(*((uint8_t *)value.str), KEY_TYPE_STRING,
+                                                   KEY_TYPE_INT64, KEY_TYPE_UINT64, KEY_TYPE_DOUBLE))) {
+                    error_set_msg("Broken key type option of index %.*s", name.len, (char *)name.str);
+                    return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                }
+                info->key_type = *((uint8_t *)value.str);
+                break;
+            case INDEX_OPTION_NODE_SIZE:
+                if (value.len != 1 || *((uint8_t *)value.str) > 30
+                    || (1 << *((uint8_t *)value.str)) < NODE_BLOCK_SIZE_MIN
+                    || (1 << *((uint8_t *)value.str)) > NODE_BLOCK_SIZE_MAX) {
+                    error_set_msg("Broken node size option of index %.*s", name.len, (char *)name.str);
+                    return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                }
+                info->node_size = 1 << *((uint8_t *)value.str);
+                break;
+            case INDEX_OPTION_COUNTED:
+                info->counted = true;
+                break;
+            case INDEX_OPTION_TOKENS:
+                if (value.len != 1) {
+                    error_set_msg("Broken tokens option of index %.*s", name.len, (char *)name.str);
+                    return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                }
+                info->tokenized = true;
+                info->token_flags = *((uint8_t *)value.str);
+                break;
+            case INDEX_OPTION_POSTINGS:
+                info->postings = true;
+                break;
+            case INDEX_OPTION_COVERING:
+                rc = _parse_covered(info, &value);
+                if (rc != WPDP_OK) {
+                    error_set_msg("Broken covering option of index %.*s", name.len, (char *)name.str);
+                    return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                }
+                break;
+            case INDEX_OPTION_FILTER:
+                if (value.len != 8) {
+                    error_set_msg("Broken filter option of index %.*s", name.len, (char *)name.str);
+                    return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+                }
+                info->ofs_filter = *((int64_t *)value.str);
+                break;
+            default:
+                // 不认识的选项
+                break;
+        }
+    }
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+/**
+ * 解析覆盖索引选项中的各属性名
+ *
+ * @param value  选项的值
+ */
+static int _parse_covered(IndexInfo *info, WPDP_String *value) {
+    const uint8_t *p = (const uint8_t *)WPDP_STRING_PTR(value);
+    int pos = 1;
+    int i;
+
+    if (value->len < 1) {
+        return WPDP_ERROR_FILE_BROKEN;
+    }
+
+    wpdp_free(info->covered);
+    info->covered_count = p[0];
+    info->covered = wpdp_new_zero(WPDP_String, info->covered_count);
+
+    for (i = 0; i < info->covered_count; i++) {
+        if (pos >= value->len || pos + 1 + p[pos] > value->len) {
+            wpdp_free(info->covered);
+            info->covered = NULL;
+            info->covered_count = 0;
+            return WPDP_ERROR_FILE_BROKEN;
+        }
+
+        info->covered[i] = wpdp_string_view(p + pos + 1, p[pos]);
+        pos += 1 + p[pos];
+    }
+
+    return WPDP_OK;
+}
+
+/**
+ * 读取索引表中的下一个索引选项
+ *
+ * @param length      索引表 blob 的长度
+ * @param pos         当前位置，读取后移动到下一项
+ * @param option_out  选项
+ * @param name_out    属性名 (指向索引表中的数据)
+ * @param value_out   选项值 (指向索引表中的数据)
+ */
+static int _next_option(StructIndexTable *table, int length, int *pos,
+                        uint8_t *option_out, WPDP_String *name_out, WPDP_String *value_out) {
+    int p = *pos;
+
+    if (p + 4 > length || table->blob[p] != INDEX_OPTION_SIGNATURE) {
+        error_set_msg("Broken index table at 0x%X", p);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    *option_out = table->blob[p + 1];
+    *name_out = wpdp_string_view(table->blob + p + 3, table->blob[p + 2]);
+    p += 3 + name_out->len;
+
+    if (p + 1 > length || p + 1 + table->blob[p] > length) {
+        error_set_msg("Broken index table at 0x%X", p);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    *value_out = wpdp_string_view(table->blob + p + 1, table->blob[p]);
+    p += 1 + value_out->len;
+
+    *pos = p;
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+/**
+ * 读取各索引的过滤器
+ *
+ * 过滤器在打开时全部读入内存，查找时不需要再读取文件
+ */
+static int _read_filters(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+    int i, rc;
+
+    for (i = 0; i < custom->_info_count; i++) {
+        IndexInfo *info = &custom->_infos[i];
+        if (info->ofs_filter == 0) {
+            continue;
+        }
+
+        section_seek(sect, info->ofs_filter, SEEK_SET, _RELATIVE);
+        rc = struct_read_filter(sect->_stream, &info->filter);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+/**
+ * 读取各哈希索引的目录
+ *
+ * 对于哈希索引，索引表中的 ofsRoot 为目录的偏移量
+ */
+static int _read_directories(Section *sect) {
+    Custom *custom = (Custom*)sect->custom;
+    int i, rc;
+
+    for (i = 0; i < custom->_info_count; i++) {
+        IndexInfo *info = &custom->_infos[i];
+        if (info->type != INDEX_TYPE_HASH) {
+            continue;
+        }
+
+        section_seek(sect, info->ofs_root, SEEK_SET, _RELATIVE);
+        rc = struct_read_hash_directory(sect->_stream, &info->directory);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+/**
+ * 获取一个结点
+ *
+ * $offset_parent 参数为 null 时表示要获取的结点是根结点。
+ * $offset_parent 参数为缺省值 -1 时表示不需要设置父结点的偏移量信息。
+ *
+ * 该方法可能会从缓存中去除某些结点
+ *
+ * @param IndexInfo $info        结点所属的索引
+ * @param integer $offset         要获取结点的偏移量 (相对)
+ * @param integer $offset_parent  要获取结点父结点的偏移量 (可选)
+ * @param p_node_out              结点
+ *
+ * @return 读取结点失败时返回 WPDP_ERROR_FILE_BROKEN，失败的结点不会被缓存
+ */
+static int _get_node(Section *sect, IndexInfo *info, int64_t offset, int64_t offset_parent,
+                     PacketNode **p_node_out) {
+    Custom *custom = (Custom*)sect->custom;
+
+    // 只有在 _splitNode_GetParentNode() 方法中，当一个结点不是根结点时，获取其父结点才会使用
+    // $offset_parent = OFFSET_PARENT_NO_NEED 的缺省参数，不设置该结点父结点的偏移量信息。
+    //
+    // index() -- 已对结点进行保护
+    // -> _treeInsert() -- 只有在插入元素后结点溢出时才调用分裂结点的方法
+    //   -> _splitNode() -- 需要调用获取父结点的方法
+    //     -> _splitNode_GetParentNode() -- 该方法只由 _splitNode() 方法调用
+    //
+    // _treeInsert() 方法在进行向 B+ 树中插入元素的操作时是从树的根结点依次向下进行的，中间
+    // 途径结点的父结点偏移量都会被保存下来。而整个过程中涉及到的结点不会被从缓存中除去，所以
+    // 在这种情况下使用该缺省参数是安全的。
+//    assert((offset_parent != OFFSET_PARENT_NO_NEED) || array_key_exists($offset, $this->_node_parents));
+
+    trace("offset = 0x%llX, parent = 0x%llX", offset, offset_parent);
+
+    PacketNode *p_node = _get_cached_node(custom, offset);
+    if (p_node != NULL) {
+        trace("found in cache");
+        *p_node_out = p_node;
+        return WPDP_OK;
+    }
+
+/*
+    if (offset_parent != OFFSET_PARENT_NO_NEED) {
+        $this->_node_parents[$offset] = $offset_parent;
+    }
+*/
+
+    trace("read from file");
+
+    p_node = _read_node(sect, info, offset, offset_parent);
+    if (p_node == NULL) {
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    _cache_node(custom, p_node);
+
+    *p_node_out = p_node;
+
+    return WPDP_OK;
+}
+
+static PacketNode *_get_cached_node(Custom *custom, int64_t offset) {
+    int i;
+
+    for (i = 0; i < custom->_p_node_count; i++) {
+        if (custom->_p_node_caches[i]->offset_self == offset) {
+            return custom->_p_node_caches[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void _cache_node(Custom *custom, PacketNode *p_node) {
+    assert(p_node != NULL);
+
+    // 缓存已满，或者超过内存上限时先淘汰较早读入的结点。对象池按大块记账，淘汰的
+    // 结点放回对象池后由之后读入的结点重复使用，对象池不再增长
+    if (custom->_p_node_count == _NODE_MAX_CACHE) {
+        _evict_nodes(custom, _NODE_AVG_CACHE);
+    } else if (custom->_p_node_count > _NODE_MIN_CACHE && wpdp_memory_exceeded()) {
+        _evict_nodes(custom, _NODE_MIN_CACHE);
+    }
 
     custom->_p_node_caches[custom->_p_node_count] = p_node;
     custom->_p_node_count++;
+}
+
+/**
+ * 预读叶子结点链表中指定结点之后的叶子结点
+ *
+ * 只预读在文件中紧接着当前结点连续存放的叶子结点 (如批量建立索引时写入的结点)，
+ * 这些结点用一次读取操作读入，放入结点缓存中。遇到不是叶子结点，或者链表不再
+ * 连续时停止。
+ *
+ * @param p_node  当前的叶子结点 (预读的结点放入缓存后可能被淘汰，返回后不应再使用)
+ * @param num     最多预读的结点数量
+ *
+ * @return 预读的结点数量，下一个叶子结点不相邻时返回 0
+ */
+static int _prefetch_leaves(Section *sect, IndexInfo *info, PacketNode *p_node, int num) {
+    Custom *custom = (Custom*)sect->custom;
+    int64_t offset = p_node->node->ofsExtra;
+    int64_t offset_parent = p_node->offset_parent;
+    int node_size = info->node_size;
+    int i;
+
+    if (offset != p_node->offset_self + node_size) {
+        return 0;
+    }
+
+    // 超过内存上限时不再预读
+    if (wpdp_memory_exceeded()) {
+        return 0;
+    }
+
+    int64_t num_available = (custom->_offset_end - offset) / node_size;
+    if (num > num_available) {
+        num = (int)num_available;
+    }
+    if (num <= 0) {
+        return 0;
+    }
+
+    trace("prefetch %d leaves from 0x%llX", num, offset);
+
+    // 读取不完整时，缓冲区中未读到的部分为 0，不会被当作结点
+    WPDP_ArenaMark mark = wpdp_arena_mark(&custom->_scratch);
+    uint8_t *buffer = wpdp_arena_alloc_zero(&custom->_scratch, node_size * num);
+    section_seek(sect, offset, SEEK_SET, _RELATIVE);
+    section_read(sect, buffer, node_size * num);
+
+    for (i = 0; i < num; i++) {
+        StructNode *node = (StructNode *)(buffer + (size_t)node_size * (size_t)i);
+
+        if (node->signature != NODE_SIGNATURE || !node->isLeaf) {
+            break;
+        }
+
+        if (_get_cached_node(custom, offset) == NULL) {
+            PacketNode *p_node_new = _alloc_node(custom, node_size);
+            memcpy(p_node_new->node, node, (size_t)node_size);
+            _init_node(custom, p_node_new, info, offset, offset_parent);
+            _cache_node(custom, p_node_new);
+        }
+
+        if (node->ofsExtra != offset + node_size) {
+            i++;
+            break;
+        }
+
+        offset += node_size;
+    }
+
+    wpdp_arena_release(&custom->_scratch, mark);
+
+    return i;
+}
+
+/**
+ * 从文件中读取结点 (不经过缓存)
+ *
+ * @return 结点，读取失败时返回 NULL
+ */
+static PacketNode *_read_node(Section *sect, IndexInfo *info, int64_t offset, int64_t offset_parent) {
+    Custom *custom = (Custom *)sect->custom;
+
+    section_seek(sect, offset, SEEK_SET, _RELATIVE);
+
+    PacketNode *p_node = _alloc_node(custom, info->node_size);
+    if (struct_read_node_into(sect->_stream, info->node_size, p_node->node) != WPDP_OK) {
+        _free_node(custom, p_node);
+        return NULL;
+    }
+
+    _init_node(custom, p_node, info, offset, offset_parent);
+
+    return p_node;
+}
+
+/**
+ * 从对象池中分配结点，结点缓冲区不清零 (随后会被读入的数据完全覆盖)
+ */
+static PacketNode *_alloc_node(Custom *custom, int node_size) {
+    PacketNode *p_node = wpdp_pool_alloc_zero(&custom->_packet_pool);
+
+    p_node->node_size = node_size;
+    p_node->node = wpdp_pool_alloc(&custom->_node_pools[_node_size_class(node_size)]);
 
     return p_node;
 }
 
+/**
+ * 设置已读入结点的信息，并建立扩展的 blob
+ */
+static void _init_node(Custom *custom, PacketNode *p_node, IndexInfo *info, int64_t offset, int64_t offset_parent) {
+    p_node->offset_self = offset;
+    p_node->offset_parent = offset_parent;
+    p_node->key_type = info->key_type;
+    p_node->node_size = info->node_size;
+    p_node->counted = info->counted;
+    p_node->postings = (info->postings && p_node->node->isLeaf);
+
+    // 数值类型的结点没有键字符串区域，不需要扩展的 blob
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        return;
+    }
+
+    // 只使用复制进来的元素与键字符串，其余部分不需要清零
+    WPDP_Pool *pool = &custom->_blob_ex_pools[_node_size_class(p_node->node_size)];
+    p_node->blob_ex = wpdp_pool_alloc(pool);
+
+    int distance_last_key = 0;
+    if (p_node->node->numElement > 0) {
+        void *ptr_last_elem = _std_elem_ptr(p_node, p_node->node->numElement - 1);
+        distance_last_key = _com_elem_key_str_distance(ptr_last_elem);
+    }
+    memcpy(p_node->blob_ex, p_node->node->blob, (size_t)(ELEMENT_SIZE * p_node->node->numElement));
+    memcpy(_ext_elem_key_str_ptr(p_node, distance_last_key),
+        _std_elem_key_str_ptr(p_node, distance_last_key),
+        (size_t)distance_last_key);
+
+    p_node->distance_furthest_key = distance_last_key;
+}
+
+/**
+ * 把结点放回对象池
+ */
+static void _free_node(Custom *custom, PacketNode *p_node) {
+    int size_class = _node_size_class(p_node->node_size);
+
+    wpdp_pool_free(&custom->_blob_ex_pools[size_class], p_node->blob_ex);
+    wpdp_pool_free(&custom->_node_pools[size_class], p_node->node);
+    wpdp_pool_free(&custom->_packet_pool, p_node);
+}
+
+/**
+ * 获取结点大小对应的对象池序号
+ */
+static int _node_size_class(int node_size) {
+    int size_class = 0;
+
+    while ((NODE_BLOCK_SIZE_MIN << size_class) < node_size) {
+        size_class++;
+    }
+
+    assert(size_class < _NODE_SIZE_CLASSES);
+
+    return size_class;
+}
+
+/**
+ * 淘汰缓存中较早读入的结点，只保留最近读入的 num_keep 个结点
+ *
+ * 调用者在获取新结点之后不应再使用之前获取的结点 (除了已经取出的值)
+ */
+static void _evict_nodes(Custom *custom, int num_keep) {
+    int num_evict = custom->_p_node_count - num_keep;
+    int i;
+
+    trace("evict %d nodes", num_evict);
+
+    for (i = 0; i < num_evict; i++) {
+        _free_node(custom, custom->_p_node_caches[i]);
+    }
+
+    memmove(custom->_p_node_caches, custom->_p_node_caches + num_evict,
+            sizeof(PacketNode *) * (size_t)num_keep);
+    custom->_p_node_count = num_keep;
+}
+
+/**
+ * 计算结点转换为固定的结点后占用的内存
+ */
+static int _pinned_node_size(PacketNode *p_node) {
+    int count = p_node->node->numElement;
+    int size = (int)sizeof(PinnedNode) + (int)sizeof(int64_t) * count;
+
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        return size + (int)sizeof(uint64_t) * count;
+    }
+
+    size += (int)sizeof(uint16_t) * count;
+
+    int i;
+    for (i = 0; i < count; i++) {
+        void *ptr_elem = _ext_elem_ptr(p_node, i);
+        void *ptr_key = _ext_elem_key_str_ptr(p_node, _com_elem_key_str_distance(ptr_elem));
+        size += _com_elem_key_str_len(ptr_key);
+    }
+
+    return size;
+}
+
+/**
+ * 把结点转换为固定的结点
+ *
+ * 固定的结点与其所有数据在同一块内存中，可以直接用 wpdp_free() 释放
+ */
+static PinnedNode *_pin_node(PacketNode *p_node) {
+    int count = p_node->node->numElement;
+    PinnedNode *pinned = wpdp_malloc_zero(_pinned_node_size(p_node));
+    void *ptr = (void *)(pinned + 1);
+    int i;
+
+    pinned->offset = p_node->offset_self;
+    pinned->ofs_extra = p_node->node->ofsExtra;
+    pinned->key_type = p_node->key_type;
+    pinned->count = count;
+
+    pinned->children = (int64_t *)ptr;
+    ptr += sizeof(int64_t) * (size_t)count;
+
+    for (i = 0; i < count; i++) {
+        pinned->children[i] = _get_element_value(p_node, i);
+    }
+
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        pinned->typed_keys = (uint64_t *)ptr;
+        memcpy(pinned->typed_keys, _typed_keys_ptr(p_node), sizeof(uint64_t) * (size_t)count);
+        return pinned;
+    }
+
+    pinned->key_ends = (uint16_t *)ptr;
+    ptr += sizeof(uint16_t) * (size_t)count;
+    pinned->keys = (uint8_t *)ptr;
+
+    int end = 0;
+    for (i = 0; i < count; i++) {
+        void *ptr_elem = _ext_elem_ptr(p_node, i);
+        void *ptr_key = _ext_elem_key_str_ptr(p_node, _com_elem_key_str_distance(ptr_elem));
+        int len_key = _com_elem_key_str_len(ptr_key);
+
+        memcpy(pinned->keys + end, ptr_key + 1, (size_t)len_key);
+        end += len_key;
+        pinned->key_ends[i] = (uint16_t)end;
+    }
+
+    return pinned;
+}
+
+/**
+ * 获取固定在内存中的结点
+ *
+ * @return 指定偏移量的结点未被固定时返回 NULL
+ */
+static PinnedNode *_get_pinned_node(Section *sect, int64_t offset) {
+    Custom *custom = (Custom*)sect->custom;
+    int low = 0, high = custom->_pinned_count - 1;
+
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int64_t offset_middle = custom->_pinned[middle]->offset;
+
+        if (offset_middle < offset) {
+            low = middle + 1;
+        } else if (offset_middle > offset) {
+            high = middle - 1;
+        } else {
+            return custom->_pinned[middle];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * 按偏移量比较两个固定的结点 (用于 qsort)
+ */
+static int _pinned_node_compare(const void *a, const void *b) {
+    int64_t offset_a = (*(PinnedNode * const *)a)->offset;
+    int64_t offset_b = (*(PinnedNode * const *)b)->offset;
+
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+/**
+ * 在固定的结点中查找指定键所在的子结点
+ *
+ * 与对普通结点使用 _binary_search_leftmost(p_node, key, true) 的结果相同
+ *
+ * @return 子结点的偏移量
+ */
+static int64_t _pinned_node_lookup(PinnedNode *pinned, WPDP_String *key) {
+    int low = 0, high = pinned->count;
+
+    // 查找第一个不小于 key 的键的位置
+    if (pinned->key_type != KEY_TYPE_STRING) {
+        uint64_t desired = *((uint64_t *)WPDP_STRING_PTR(key));
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (pinned->typed_keys[middle] < desired) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < pinned->count && pinned->typed_keys[low] == desired) {
+            return pinned->children[low];
+        }
+    } else {
+        WPDP_String key_in_node;
+        int cmp = -1;
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            int start = (middle == 0) ? 0 : pinned->key_ends[middle - 1];
+            key_in_node = wpdp_string_view(pinned->keys + start, pinned->key_ends[middle] - start);
+            if (wpdp_string_compare(&key_in_node, key) < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < pinned->count) {
+            int start = (low == 0) ? 0 : pinned->key_ends[low - 1];
+            key_in_node = wpdp_string_view(pinned->keys + start, pinned->key_ends[low] - start);
+            cmp = wpdp_string_compare(&key_in_node, key);
+        }
+        if (cmp == 0) {
+            return pinned->children[low];
+        }
+    }
+
+    return (low == 0) ? pinned->ofs_extra : pinned->children[low - 1];
+}
+
 /**
  * 查找指定键在结点中的最左元素的位置
  *
@@ -316,7 +2081,11 @@ static PacketNode *_get_node(Section *sect, int64_t offset, int64_t offset_paren
  * @return integer 位置
  */
 static int _binary_search_leftmost(PacketNode *p_node, WPDP_String *desired, bool for_lookup) {
-    trace("desired = %s, %s", desired->str, (for_lookup ? ", for lookup" : ""));
+    trace("desired = %s, %s", (char *)WPDP_STRING_PTR(desired), (for_lookup ? ", for lookup" : ""));
+
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        return _typed_search_leftmost(p_node, *((uint64_t *)WPDP_STRING_PTR(desired)), for_lookup);
+    }
 
     int count = p_node->node->numElement;
 
@@ -358,6 +2127,44 @@ static int _binary_search_leftmost(PacketNode *p_node, WPDP_String *desired, boo
     }
 }
 
+/**
+ * 在数值类型的结点中查找指定键的最左元素的位置
+ *
+ * 返回值与 _binary_search_leftmost() 相同。键数组是连续的 uint64，这里使用
+ * 无分支的二分查找 (循环内只有条件传送)，循环次数只与元素数量有关
+ *
+ * @param desired     要查找的键 (已编码)
+ * @param for_lookup  是否用于查找元素目的
+ *
+ * @return 位置
+ */
+static int _typed_search_leftmost(PacketNode *p_node, uint64_t desired, bool for_lookup) {
+    const uint64_t *keys = _typed_keys_ptr(p_node);
+    int count = p_node->node->numElement;
+
+    if (count == 0) {
+        return (for_lookup ? -1 : _BINARY_SEARCH_NOT_FOUND);
+    }
+
+    const uint64_t *base = keys;
+    int n = count;
+
+    while (n > 1) {
+        int half = n / 2;
+        base = (base[half - 1] < desired) ? (base + half) : base;
+        n -= half;
+    }
+
+    // pos 为第一个不小于 desired 的键的位置
+    int pos = (int)(base - keys) + (*base < desired);
+
+    if (pos < count && keys[pos] == desired) {
+        return pos;
+    }
+
+    return (for_lookup ? (pos - 1) : _BINARY_SEARCH_NOT_FOUND);
+}
+
 /**
  * 比较结点中指定下标元素的键与另一个给定键的大小
  *
@@ -371,23 +2178,250 @@ static int _binary_search_leftmost(PacketNode *p_node, WPDP_String *desired, boo
 static int _key_compare(PacketNode *p_node, int index, WPDP_String *key) {
 //    assert('array_key_exists($index, $node[\'elements\'])');
 
-    WPDP_String *key_in_elem = _get_element_key(p_node, index);
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        uint64_t key_1 = _typed_keys_ptr(p_node)[index];
+        uint64_t key_2 = *((uint64_t *)WPDP_STRING_PTR(key));
+        return (key_1 > key_2) - (key_1 < key_2);
+    }
+
+    WPDP_String key_in_elem;
+    _get_element_key(p_node, index, &key_in_elem);
 
-    int retval = wpdp_string_compare(key_in_elem, key);
+    int retval = wpdp_string_compare(&key_in_elem, key);
 
     return retval;
 }
 
-static WPDP_String *_get_element_key(PacketNode *p_node, int index) {
+/**
+ * 获取结点中指定下标元素的键 (直接指向结点的数据，不分配内存)
+ */
+static void _get_element_key(PacketNode *p_node, int index, WPDP_String *key_out) {
     void *ptr_elem = _ext_elem_ptr(p_node, index);
     void *ptr_key = _ext_elem_key_str_ptr(p_node, _com_elem_key_str_distance(ptr_elem));
-    int len_key = _com_elem_key_str_len(ptr_key);
 
-    return wpdp_string_direct(ptr_key + 1, len_key);
+    *key_out = wpdp_string_view(ptr_key + 1, _com_elem_key_str_len(ptr_key));
 }
 
 static int64_t _get_element_value(PacketNode *p_node, int index) {
+    if (p_node->key_type != KEY_TYPE_STRING) {
+        return _typed_values_ptr(p_node)[index];
+    }
+
     void *ptr_elem = _ext_elem_ptr(p_node, index);
 
     return *((int64_t *)(ptr_elem + ELEMENT_VALUE_OFFSET));
 }
+
+/**
+ * 获取普通结点中指定子树的元素数量
+ *
+ * @param index  元素的下标，为 -1 时表示 ofsExtra 所指的子树
+ */
+static int64_t _get_child_count(PacketNode *p_node, int index) {
+    assert(p_node->counted && !p_node->node->isLeaf);
+
+    if (index == -1) {
+        return p_node->node->cntExtra;
+    }
+
+    int64_t count;
+    memcpy(&count, (uint8_t *)_counts_ptr(p_node) + sizeof(int64_t) * (size_t)index, sizeof(int64_t));
+
+    return count;
+}
+
+/**
+ * 查找结点中第一个键不小于 (或大于) 指定键的元素的位置
+ *
+ * @param upper  为 true 时查找第一个大于指定键的元素
+ *
+ * @return 位置，没有这样的元素时返回元素数量
+ */
+static int _node_bound(PacketNode *p_node, WPDP_String *key, bool upper) {
+    int low = 0, high = p_node->node->numElement;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        int cmp = _key_compare(p_node, middle, key);
+
+        if (cmp < 0 || (upper && cmp == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * 把属性值转换为索引中的键
+ *
+ * 字符串类型的索引直接使用属性值，数值类型的索引转换为编码后的 8 字节
+ *
+ * @param value      属性值
+ * @param key_out    键
+ * @param typed_out  编码后的数值 (同时内联保存在 key_out 中)
+ */
+static int _prepare_key(IndexInfo *info, WPDP_String *value, WPDP_String *key_out, uint64_t *typed_out) {
+    if (info->key_type == KEY_TYPE_STRING) {
+        *key_out = *value;
+        return WPDP_OK;
+    }
+
+    int rc = _encode_typed_key(info->key_type, value, typed_out);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    wpdp_string_init(key_out, typed_out, (int)sizeof(uint64_t));
+
+    return WPDP_OK;
+}
+
+/**
+ * 把属性值转换为数值类型索引的键
+ *
+ * 属性值必须完整地是一个数值，前后不能有空白或其它字符 (包括 '\0')，无符号类型
+ * 不接受负号，超出类型范围的值视为无效
+ *
+ * @param key_type  键类型
+ * @param value     属性值 (十进制或浮点数的字符串)
+ * @param key_out   编码后的键
+ */
+static int _encode_typed_key(uint8_t key_type, WPDP_String *value, uint64_t *key_out) {
+    assert(IN_ARRAY_3(key_type, KEY_TYPE_INT64, KEY_TYPE_UINT64, KEY_TYPE_DOUBLE));
+
+    char buffer[64];
+    char *end;
+    uint64_t bits;
+
+    if (value->len == 0 || value->len >= (int)sizeof(buffer)) {
+        error_set_msg("Invalid numeric attribute value (length %d)", value->len);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    memcpy(buffer, WPDP_STRING_PTR(value), (size_t)value->len);
+    buffer[value->len] = '\0';
+
+    // strto* 会跳过前导空白，且 strtoull 会把负数取反后返回，需要预先排除
+    if (isspace((unsigned char)buffer[0]) ||
+        (key_type == KEY_TYPE_UINT64 && buffer[0] == '-')) {
+        error_set_msg("Invalid numeric attribute value %s", buffer);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    errno = 0;
+
+    switch (key_type) {
+        case KEY_TYPE_INT64:
+            bits = (uint64_t)strtoll(buffer, &end, 10) ^ 0x8000000000000000ull;
+            break;
+        case KEY_TYPE_UINT64:
+            bits = (uint64_t)strtoull(buffer, &end, 10);
+            break;
+        default: {
+            double d = strtod(buffer, &end);
+            memcpy(&bits, &d, sizeof(bits));
+            bits = (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+            break;
+        }
+    }
+
+    // 属性值中间有 '\0' 时 strto* 会提前结束
+    if (end == buffer || end != buffer + value->len || errno == ERANGE) {
+        error_set_msg("Invalid numeric attribute value %s", buffer);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    *key_out = bits;
+
+    return WPDP_OK;
+}
+
+/**
+ * 扩大偏移量数组，使其至少能容纳 count_min 个值
+ *
+ * @return 数组大小超出 int 的范围时返回 WPDP_ERROR_EXCEED_LIMIT
+ */
+static int _offsets_reserve(int64_t **offsets, int64_t count_min, int *capacity) {
+    int64_t capacity_new = *capacity;
+
+    if (count_min <= capacity_new) {
+        return WPDP_OK;
+    }
+
+    if (count_min > _OFFSETS_MAX_CAPACITY) {
+        error_set_msg("Too many offsets (%lld)", (long long)count_min);
+        return WPDP_ERROR_EXCEED_LIMIT;
+    }
+
+    while (capacity_new < count_min) {
+        capacity_new = (capacity_new == 0) ? _OFFSETS_INIT_CAPACITY : capacity_new * 2;
+    }
+    if (capacity_new > _OFFSETS_MAX_CAPACITY) {
+        capacity_new = _OFFSETS_MAX_CAPACITY;
+    }
+
+    *capacity = (int)capacity_new;
+    *offsets = wpdp_realloc(*offsets, (int)sizeof(int64_t) * (*capacity));
+
+    return WPDP_OK;
+}
+
+static int _offsets_append(int64_t **offsets, int *count, int *capacity, int64_t offset) {
+    int rc = _offsets_reserve(offsets, (int64_t)*count + 1, capacity);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    (*offsets)[*count] = offset;
+    (*count)++;
+
+    return WPDP_OK;
+}
+
+/**
+ * 把叶子结点中指定元素的值加入偏移量数组
+ *
+ * 使用压缩的偏移量列表的叶子结点中，元素的值为列表在 blob 中的位置，这里解码
+ * 该列表中的所有值
+ *
+ * @return 列表的位置或长度超出结点时返回 WPDP_ERROR_FILE_BROKEN
+ */
+static int _offsets_append_element(PacketNode *p_node, int index,
+                                   int64_t **offsets, int *count, int *capacity) {
+    if (!p_node->postings) {
+        return _offsets_append(offsets, count, capacity, _get_element_value(p_node, index));
+    }
+
+    int64_t position = _get_element_value(p_node, index);
+    int size = NODE_DATA_SIZE_OF(p_node->node_size);
+    int num, rc;
+
+    if (position < 0 || position >= size) {
+        error_set_msg("Posting list position %lld exceeds the node", (long long)position);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    const uint8_t *block = p_node->node->blob + position;
+    size -= (int)position;
+
+    rc = postings_count(block, size, &num);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = _offsets_reserve(offsets, (int64_t)*count + num, capacity);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = postings_decode(block, size, *offsets + *count);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *count += num;
+
+    return WPDP_OK;
+}
+
+#ifdef WPDP_TEST
+/**
+ * 测试用: 调用 _encode_typed_key()
+ */
+int test_indexes_encode_typed_key(uint8_t key_type, WPDP_String *value, uint64_t *key_out) {
+    return _encode_typed_key(key_type, value, key_out);
+}
+#endif
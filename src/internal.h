@@ -22,6 +22,7 @@ typedef struct _WPDP_Entry_Args     WPDP_Entry_Args;
 #include "malloc.h"
 #include "structs.h"
 #include "wpdp.h"
+#include "thread.h"
 
 // 定位方式常量
 enum _OffsetType {
@@ -55,6 +56,8 @@ struct _WPDP_Entry_Args {
     WPDP_Entry_Attributes   *attributes;            // 条目属性
 };
 
+WPDP_Entry *wpdp_entry_create(WPDP *dp, PacketMetadata *meta, WPDP_Entry_Attributes *attributes);
+
 WPDP_Entry_Attributes *wpdp_entry_attributes_create(void);
 int wpdp_entry_attributes_add(WPDP_Entry_Attributes *attrs, WPDP_Entry_Attribute *attr);
 int wpdp_entry_attributes_free(WPDP_Entry_Attributes *attrs);
@@ -66,6 +69,7 @@ int section_init(uint8_t sect_type, WPIO_Stream *stream,
 int section_create(uint8_t file_type, uint8_t sect_type,
                    WPIO_Stream *stream);
 WPIO_Stream *section_get_stream(Section *sect);
+void section_free(Section *sect);
 int section_read_header(Section *sect);
 int section_write_header(Section *sect);
 int section_read_section(Section *sect, uint8_t sect_type);
@@ -73,9 +77,9 @@ int section_write_section(Section *sect);
 int64_t section_tell(Section *sect, OffsetType offset_type);
 int section_seek(Section *sect, int64_t offset, int origin, OffsetType offset_type);
 int section_read(Section *sect, void *buffer, int length);
-int section_write(Section *sect, void *data, int length);
 
 int section_contents_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect_out);
+void section_contents_close(Section *sect);
 int section_contents_create(WPIO_Stream *stream);
 int section_contents_flush(Section *sect);
 int64_t section_contents_get_section_length(Section *sect);
@@ -84,26 +88,63 @@ int section_contents_transfer(Section *sect, WPDP_Entry_Args *args, const void *
 int section_contents_commit(Section *sect, WPDP_Entry_Args *args);
 
 int section_metadata_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect_out);
+void section_metadata_close(Section *sect);
+void section_metadata_shrink(Section *sect);
 int section_metadata_create(WPIO_Stream *stream);
 int section_metadata_flush(Section *sect);
 int64_t section_metadata_get_section_length(Section *sect);
 int section_metadata_add(Section *sect, WPDP_Entry_Args *args);
+int section_metadata_get_metadata(Section *sect, int64_t offset, PacketMetadata **p_metadata_out);
+int section_metadata_get_first(Section *sect, PacketMetadata **p_metadata_out);
+int section_metadata_get_next(Section *sect, PacketMetadata *p_current, PacketMetadata **p_next_out);
+int section_metadata_get_prev(Section *sect, PacketMetadata *p_current, PacketMetadata **p_prev_out);
+void section_metadata_release(Section *sect, PacketMetadata *p_metadata);
+int64_t section_metadata_get_first_offset(Section *sect);
+int section_metadata_read_metadata(Section *sect, int64_t offset, WPDP_Arena *arena,
+                                   StructMetadata **metadata_out);
+int section_metadata_read_window(Section *sect, int64_t offset, void *buffer, int length, int *length_out);
+int section_metadata_load_window(Section *sect, WPDP_MetadataWindow *window, int64_t offset,
+                                 WPDP_Mutex *io_lock, StructMetadata **metadata_out);
+int section_metadata_find_boundary(Section *sect, int64_t offset, int64_t *boundary_out);
+int section_metadata_get_count(Section *sect, int64_t *count_out);
+int section_metadata_get_offset_at(Section *sect, int64_t n, int64_t *offset_out);
+int section_metadata_get_index_of(Section *sect, int64_t offset, int64_t *index_out);
 
 int section_indexes_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect_out);
+void section_indexes_close(Section *sect);
+void section_indexes_shrink(Section *sect);
 int64_t section_indexes_get_section_length(Section *sect);
-void *section_indexes_find(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value);
+bool section_indexes_exists(Section *sect, WPDP_String *attr_name);
+bool section_indexes_is_tokenized(Section *sect, WPDP_String *attr_name);
+int section_indexes_list(Section *sect, WPDP_String ***names_out, int *count_out);
+int section_indexes_get_token_flags(Section *sect, WPDP_String *attr_name, uint8_t *flags_out);
+int section_indexes_find_many(Section *sect, WPDP_String *attr_name, WPDP_String *keys, int n,
+                              WPDP_QueryCallback callback, void *arg);
+int section_indexes_count(Section *sect, WPDP_String *attr_name, WPDP_String *lo, WPDP_String *hi,
+                          int64_t *count_out);
+int section_indexes_select(Section *sect, WPDP_String *attr_name, WPDP_String *lo, WPDP_String *hi,
+                           int64_t skip, int limit, int64_t **offsets_out, int *count_out);
+int section_indexes_get_covered(Section *sect, WPDP_String *attr_name, WPDP_String **names_out, int *count_out);
+int section_indexes_find_covering(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value,
+                                  WPDP_CoveringCallback callback, void *arg);
+int section_indexes_pin(Section *sect, int64_t budget);
+int64_t section_indexes_get_pinned_memory(Section *sect);
+int section_indexes_find(Section *sect, WPDP_String *attr_name, WPDP_String *attr_value,
+                         int64_t **offsets_out, int *count_out);
 
 int struct_create_header(StructHeader **header_out);
 int struct_create_section(StructSection **section_out);
 int struct_create_metadata(StructMetadata **metadata_out);
 int struct_create_index_table(StructIndexTable **index_table_out);
-int struct_create_node(StructNode **node_out);
+int struct_create_node(int block_size, StructNode **node_out);
 
 int struct_read_header(WPIO_Stream *stream, StructHeader **header_out);
 int struct_read_section(WPIO_Stream *stream, StructSection **section_out);
-int struct_read_node(WPIO_Stream *stream, StructNode **node_out);
+int struct_read_node_into(WPIO_Stream *stream, int block_size, StructNode *node);
 int struct_read_metadata(WPIO_Stream *stream, StructMetadata **ptr_out, bool noblob);
 int struct_read_index_table(WPIO_Stream *stream, StructIndexTable **ptr_out, bool noblob);
+int struct_read_filter(WPIO_Stream *stream, StructFilter **ptr_out);
+int struct_read_hash_directory(WPIO_Stream *stream, StructHashDirectory **ptr_out);
 
 int struct_write_header(WPIO_Stream *stream, StructHeader *header);
 int struct_write_section(WPIO_Stream *stream, StructSection *section);
@@ -112,9 +153,27 @@ int struct_write_metadata(WPIO_Stream *stream, StructMetadata *metadata);
 int struct_write_index_table(WPIO_Stream *stream, StructIndexTable *index_table);
 
 int struct_get_block_length(int block_size, int actual_length);
+int struct_get_metadata_attribute(StructMetadata *metadata, WPDP_String *name, WPDP_String *value_out);
+int struct_next_metadata_attribute(StructMetadata *metadata, int *pos,
+                                   WPDP_String *name_out, WPDP_String *value_out);
+
+bool filter_may_contain(StructFilter *filter, WPDP_String *key);
+
+int postings_count(const uint8_t *block, int size, int *count_out);
+int postings_decode(const uint8_t *block, int size, int64_t *offsets_out);
+
+int columns_export(WPDP *dp, WPIO_Stream *stream);
 
 Section     *contents_open(WPIO_Stream *stream);
 
 void indexes_create(WPIO_Stream *stream);
 
+#ifdef WPDP_TEST
+// 测试用的入口 (test.c)
+int test_query_gallop(const int64_t *offsets, int lo, int count, int64_t desired);
+int test_query_intersect(int64_t *dst, int dst_count, const int64_t *src, int src_count);
+int test_query_subtract(int64_t *dst, int dst_count, const int64_t *src, int src_count);
+int test_indexes_encode_typed_key(uint8_t key_type, WPDP_String *value, uint64_t *key_out);
+#endif
+
 #endif // _INTERNAL_H_
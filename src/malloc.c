@@ -1,21 +1,503 @@
 #include "internal.h"
 #include "malloc.h"
+#include "thread.h"
+
+static void *_default_alloc(void *ctx, size_t size);
+static void *_default_realloc(void *ctx, void *p, size_t old_size, size_t new_size);
+static void _default_free(void *ctx, void *p, size_t size);
+static void *_fallback_alloc_aligned(void *ctx, size_t size, size_t alignment);
+static void _fallback_free_aligned(void *ctx, void *p, size_t size, size_t alignment);
+
+// 当前使用的分配器
+static WPDP_Allocator _allocator = {
+    _default_alloc, _default_realloc, _default_free,
+    _fallback_alloc_aligned, _fallback_free_aligned, NULL
+};
+static bool _allocator_used = false;    // 是否已经分配过内存 (之后不能再更换分配器)
+
+/**
+ * 大小未知的分配 (wpdp_malloc_zero() 等) 在数据之前保存数据的大小，释放时传给分配器
+ *
+ * 头部为 16 字节，以保持分配器返回的地址的对齐
+ */
+#define _SIZE_HEADER    16
+
+/**
+ * 设置分配器
+ *
+ * 所有内存 (包括对象池与内存区的大块) 都通过分配器分配。释放时总是传入分配时的大小，
+ * 可以直接使用需要大小的释放函数 (如 jemalloc 的 sdallocx)。realloc 为 NULL 时
+ * 使用分配、复制与释放代替，alloc_aligned 与 free_aligned 都为 NULL 时在 alloc
+ * 分配的内存中对齐
+ *
+ * 只能在第一次分配内存之前 (打开任何数据堆之前) 调用
+ *
+ * @param allocator  分配器，为 NULL 时恢复使用 malloc/free
+ */
+WPDP_API int wpdp_set_allocator(const WPDP_Allocator *allocator) {
+    if (_allocator_used) {
+        error_set_msg("The allocator cannot be changed after memory has been allocated");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (allocator == NULL) {
+        _allocator.alloc = _default_alloc;
+        _allocator.realloc = _default_realloc;
+        _allocator.free = _default_free;
+        _allocator.alloc_aligned = _fallback_alloc_aligned;
+        _allocator.free_aligned = _fallback_free_aligned;
+        _allocator.ctx = NULL;
+        return WPDP_OK;
+    }
+
+    if (allocator->alloc == NULL || allocator->free == NULL
+        || ((allocator->alloc_aligned == NULL) != (allocator->free_aligned == NULL))) {
+        error_set_msg("Incomplete allocator");
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    _allocator = *allocator;
+    if (_allocator.alloc_aligned == NULL) {
+        _allocator.alloc_aligned = _fallback_alloc_aligned;
+        _allocator.free_aligned = _fallback_free_aligned;
+    }
+
+    return WPDP_OK;
+}
+
+/**
+ * 分配指定大小的内存 (不清零)，释放时必须使用 wpdp_free_sized() 并传入相同的大小
+ */
+void *wpdp_alloc_sized(size_t size) {
+    _allocator_used = true;
+
+    return _allocator.alloc(_allocator.ctx, size);
+}
+
+void wpdp_free_sized(void *p, size_t size) {
+    if (p) {
+        _allocator.free(_allocator.ctx, p, size);
+    }
+}
+
+/**
+ * 分配按 alignment 对齐的内存 (不清零)
+ *
+ * @param alignment  对齐 (2 的整次幂)
+ */
+void *wpdp_alloc_aligned(size_t size, size_t alignment) {
+    _allocator_used = true;
+
+    return _allocator.alloc_aligned(_allocator.ctx, size, alignment);
+}
+
+void wpdp_free_aligned(void *p, size_t size, size_t alignment) {
+    if (p) {
+        _allocator.free_aligned(_allocator.ctx, p, size, alignment);
+    }
+}
 
 void *wpdp_malloc_zero(int n) {
-    void *p = malloc((size_t)n);
+    uint8_t *base = wpdp_alloc_sized(_SIZE_HEADER + (size_t)n);
+    if (base == NULL) {
+        return NULL;
+    }
+
+    *(size_t *)base = (size_t)n;
+    memset(base + _SIZE_HEADER, 0, (size_t)n);
+
+    return base + _SIZE_HEADER;
+}
+
+void *wpdp_realloc(void *p, int n) {
+    uint8_t *base;
+
+    if (p == NULL) {
+        base = wpdp_alloc_sized(_SIZE_HEADER + (size_t)n);
+    } else {
+        uint8_t *base_old = (uint8_t *)p - _SIZE_HEADER;
+        size_t old_size = *(size_t *)base_old;
+
+        if (_allocator.realloc != NULL) {
+            base = _allocator.realloc(_allocator.ctx, base_old, _SIZE_HEADER + old_size, _SIZE_HEADER + (size_t)n);
+        } else {
+            // 分配器不支持 realloc 时分配新的内存并复制
+            base = wpdp_alloc_sized(_SIZE_HEADER + (size_t)n);
+            if (base != NULL) {
+                memcpy(base + _SIZE_HEADER, p, (old_size < (size_t)n) ? old_size : (size_t)n);
+                wpdp_free_sized(base_old, _SIZE_HEADER + old_size);
+            }
+        }
+    }
+
+    if (base == NULL) {
+        return NULL;
+    }
+
+    *(size_t *)base = (size_t)n;
+
+    return base + _SIZE_HEADER;
+}
+
+void wpdp_free(void *p) {
+    if (p) {
+        uint8_t *base = (uint8_t *)p - _SIZE_HEADER;
+        wpdp_free_sized(base, _SIZE_HEADER + *(size_t *)base);
+    }
+}
+
+static void *_default_alloc(void *ctx, size_t size) {
+    (void)ctx;
+
+    return malloc(size);
+}
+
+static void *_default_realloc(void *ctx, void *p, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+
+    return realloc(p, new_size);
+}
+
+static void _default_free(void *ctx, void *p, size_t size) {
+    (void)ctx;
+    (void)size;
+
+    free(p);
+}
+
+/**
+ * 在 alloc 分配的内存中对齐 (多分配 alignment 字节，对齐后的地址之前保存原地址)
+ */
+static void *_fallback_alloc_aligned(void *ctx, size_t size, size_t alignment) {
+    if (alignment < sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+
+    uint8_t *base = _allocator.alloc(ctx, size + alignment);
+    if (base == NULL) {
+        return NULL;
+    }
+
+    uintptr_t aligned = ((uintptr_t)base + alignment) & ~((uintptr_t)alignment - 1);
+    ((void **)aligned)[-1] = base;
+
+    return (void *)aligned;
+}
+
+static void _fallback_free_aligned(void *ctx, void *p, size_t size, size_t alignment) {
+    if (alignment < sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+
+    _allocator.free(ctx, ((void **)p)[-1], size + alignment);
+}
+
+static int64_t _memory_limit = 0;                           // 内存上限，为 0 时表示不限制
+static int64_t _memory_usage[WPDP_MEMORY_COMPONENTS];       // 各用途使用的内存
+
+/**
+ * 记录分配的内存
+ *
+ * 可能在扫描的多个线程中同时调用，所以使用原子操作
+ *
+ * @param component  用途 (WPDP_MEMORY_*)
+ * @param size       字节数
+ */
+void wpdp_memory_charge(int component, int64_t size) {
+    assert(component >= 0 && component < WPDP_MEMORY_COMPONENTS);
+
+    wpdp_atomic_add64(&_memory_usage[component], size);
+}
+
+/**
+ * 记录释放的内存
+ */
+void wpdp_memory_uncharge(int component, int64_t size) {
+    assert(component >= 0 && component < WPDP_MEMORY_COMPONENTS);
+
+    wpdp_atomic_add64(&_memory_usage[component], -size);
+}
+
+/**
+ * 检查使用的内存是否已超过上限
+ */
+bool wpdp_memory_exceeded(void) {
+    int64_t total = 0;
+    int i;
+
+    if (_memory_limit <= 0) {
+        return false;
+    }
+
+    for (i = 0; i < WPDP_MEMORY_COMPONENTS; i++) {
+        total += _memory_usage[i];
+    }
+
+    return (total > _memory_limit);
+}
+
+/**
+ * 设置所有数据堆共用的内存上限
+ *
+ * 上限只约束可以淘汰的缓存: 超过上限时各缓存在增长之前先缩小，已固定的索引结点
+ * 与正在使用的缓冲区不受影响
+ *
+ * @param limit  上限 (字节)，为 0 时表示不限制
+ */
+WPDP_API int wpdp_set_memory_limit(int64_t limit) {
+    if (limit < 0) {
+        error_set_msg("Memory limit must not be negative");
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    _memory_limit = limit;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取当前的内存使用情况
+ *
+ * @param stats_out  内存使用情况
+ */
+WPDP_API int wpdp_get_memory_stats(WPDP_MemoryStats *stats_out) {
+    int i;
+
+    stats_out->limit = _memory_limit;
+    stats_out->total = 0;
+
+    for (i = 0; i < WPDP_MEMORY_COMPONENTS; i++) {
+        stats_out->components[i] = _memory_usage[i];
+        stats_out->total += _memory_usage[i];
+    }
+
+    return WPDP_OK;
+}
+
+// 块的头部，数据紧随其后 (按 8 字节对齐)
+struct _ArenaChunk {
+    ArenaChunk  *prev;
+    int64_t     size;
+};
+
+#define _ARENA_ALIGN(n)     (((n) + 7) & ~7)
+
+/**
+ * 初始化内存区
+ *
+ * @param chunk_size  块大小，为 0 时使用 WPDP_ARENA_CHUNK_SIZE
+ */
+void wpdp_arena_init(WPDP_Arena *arena, int chunk_size) {
+    arena->chunk = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+    arena->chunk_size = (chunk_size > 0) ? chunk_size : WPDP_ARENA_CHUNK_SIZE;
+}
+
+/**
+ * 从内存区中分配内存 (不清零)
+ *
+ * 超过块大小的请求单独分配一个块
+ */
+void *wpdp_arena_alloc(WPDP_Arena *arena, int n) {
+    void *p;
+
+    n = _ARENA_ALIGN(n);
+
+    if (arena->ptr == NULL || n > arena->end - arena->ptr) {
+        int size = (n > arena->chunk_size) ? n : arena->chunk_size;
+        ArenaChunk *chunk = wpdp_alloc_sized(sizeof(ArenaChunk) + (size_t)size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+
+        chunk->prev = arena->chunk;
+        chunk->size = size;
+        wpdp_memory_charge(WPDP_MEMORY_BUFFERS, (int64_t)size);
+
+        arena->chunk = chunk;
+        arena->ptr = (uint8_t *)(chunk + 1);
+        arena->end = arena->ptr + size;
+    }
+
+    p = arena->ptr;
+    arena->ptr += n;
+
+    return p;
+}
+
+void *wpdp_arena_alloc_zero(WPDP_Arena *arena, int n) {
+    void *p = wpdp_arena_alloc(arena, n);
     if (p) {
         memset(p, 0, (size_t)n);
     }
     return p;
 }
 
-void *wpdp_realloc(void *p, int n) {
-    return realloc(p, (size_t)n);
+/**
+ * 记下内存区当前的位置
+ */
+WPDP_ArenaMark wpdp_arena_mark(WPDP_Arena *arena) {
+    WPDP_ArenaMark mark;
+
+    mark.chunk = arena->chunk;
+    mark.ptr = arena->ptr;
+
+    return mark;
 }
 
-void wpdp_free(void *p) {
+/**
+ * 释放记下位置之后分配的全部内存
+ */
+void wpdp_arena_release(WPDP_Arena *arena, WPDP_ArenaMark mark) {
+    while (arena->chunk != mark.chunk) {
+        ArenaChunk *chunk = arena->chunk;
+
+        // 记下位置时还没有任何块，保留第一个块
+        if (mark.chunk == NULL && chunk->prev == NULL) {
+            arena->ptr = (uint8_t *)(chunk + 1);
+            arena->end = arena->ptr + chunk->size;
+            return;
+        }
+
+        arena->chunk = chunk->prev;
+        wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, chunk->size);
+        wpdp_free_sized(chunk, sizeof(ArenaChunk) + (size_t)chunk->size);
+    }
+
+    if (arena->chunk != NULL) {
+        arena->ptr = mark.ptr;
+        arena->end = (uint8_t *)(arena->chunk + 1) + arena->chunk->size;
+    }
+}
+
+/**
+ * 释放内存区的全部内存
+ */
+void wpdp_arena_destroy(WPDP_Arena *arena) {
+    while (arena->chunk != NULL) {
+        ArenaChunk *chunk = arena->chunk;
+        arena->chunk = chunk->prev;
+        wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, chunk->size);
+        wpdp_free_sized(chunk, sizeof(ArenaChunk) + (size_t)chunk->size);
+    }
+
+    arena->ptr = NULL;
+    arena->end = NULL;
+}
+
+/**
+ * 初始化对象池
+ *
+ * @param object_size   对象大小
+ * @param alignment     对象的对齐 (2 的整次幂，不小于指针的大小)
+ * @param slab_objects  每次向系统申请的对象数量
+ * @param component     大块记账的用途 (WPDP_MEMORY_*)，WPDP_POOL_NO_CHARGE 表示不记账
+ */
+void wpdp_pool_init(WPDP_Pool *pool, int object_size, int alignment, int slab_objects, int component) {
+    assert(alignment >= (int)sizeof(void *) && (alignment & (alignment - 1)) == 0);
+
+    pool->free_list = NULL;
+    pool->slabs = NULL;
+    pool->ptr = NULL;
+    pool->end = NULL;
+    pool->object_size = (object_size + alignment - 1) & ~(alignment - 1);
+    pool->alignment = alignment;
+    pool->slab_objects = (slab_objects > 0) ? slab_objects : 1;
+    pool->live = 0;
+    pool->component = component;
+}
+
+static size_t _pool_slab_size(WPDP_Pool *pool) {
+    return (size_t)pool->alignment + (size_t)pool->object_size * (size_t)pool->slab_objects;
+}
+
+/**
+ * 从对象池中分配一个对象 (不清零，用于随后会被完全覆盖的缓冲区)
+ */
+void *wpdp_pool_alloc(WPDP_Pool *pool) {
+    void *p;
+
+    if (pool->free_list != NULL) {
+        p = pool->free_list;
+        pool->free_list = *(void **)p;
+        pool->live++;
+        return p;
+    }
+
+    if (pool->ptr == NULL || pool->ptr == pool->end) {
+        // 大块按 alignment 对齐，开头保存前一个大块的指针，其后的 alignment 处开始存放各对象
+        uint8_t *slab = wpdp_alloc_aligned(_pool_slab_size(pool), (size_t)pool->alignment);
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        *(void **)slab = pool->slabs;
+        pool->slabs = slab;
+
+        if (pool->component != WPDP_POOL_NO_CHARGE) {
+            wpdp_memory_charge(pool->component, (int64_t)_pool_slab_size(pool));
+        }
+
+        pool->ptr = slab + pool->alignment;
+        pool->end = pool->ptr + (size_t)pool->object_size * (size_t)pool->slab_objects;
+    }
+
+    p = pool->ptr;
+    pool->ptr += pool->object_size;
+    pool->live++;
+
+    return p;
+}
+
+void *wpdp_pool_alloc_zero(WPDP_Pool *pool) {
+    void *p = wpdp_pool_alloc(pool);
+    if (p) {
+        memset(p, 0, (size_t)pool->object_size);
+    }
+    return p;
+}
+
+/**
+ * 把对象放回对象池
+ */
+void wpdp_pool_free(WPDP_Pool *pool, void *p) {
     if (p) {
-        free(p);
-        p = NULL;
+        *(void **)p = pool->free_list;
+        pool->free_list = p;
+        pool->live--;
     }
 }
+
+/**
+ * 所有对象都已放回时，把全部大块交还给系统
+ *
+ * 空闲链表中的对象分散在各个大块中，只有在没有使用中的对象时才能释放，所以由
+ * 淘汰全部缓存的调用者 (如 shrink) 在淘汰之后调用
+ */
+void wpdp_pool_trim(WPDP_Pool *pool) {
+    if (pool->live == 0) {
+        wpdp_pool_destroy(pool);
+    }
+}
+
+/**
+ * 销毁对象池，释放所有对象 (之后对象池仍可继续分配)
+ */
+void wpdp_pool_destroy(WPDP_Pool *pool) {
+    while (pool->slabs != NULL) {
+        void *slab = pool->slabs;
+        pool->slabs = *(void **)slab;
+        wpdp_free_aligned(slab, _pool_slab_size(pool), (size_t)pool->alignment);
+
+        if (pool->component != WPDP_POOL_NO_CHARGE) {
+            wpdp_memory_uncharge(pool->component, (int64_t)_pool_slab_size(pool));
+        }
+    }
+
+    pool->free_list = NULL;
+    pool->live = 0;
+    pool->ptr = NULL;
+    pool->end = NULL;
+}
@@ -4,10 +4,92 @@
 #define wpdp_new_zero(struct_type, n_structs)   \
     ((struct_type*)wpdp_malloc_zero((int)sizeof(struct_type) * n_structs))
 
+void *wpdp_alloc_sized(size_t size);
+void wpdp_free_sized(void *p, size_t size);
+void *wpdp_alloc_aligned(size_t size, size_t alignment);
+void wpdp_free_aligned(void *p, size_t size, size_t alignment);
+
 void *wpdp_malloc_zero(int n);
 
 void *wpdp_realloc(void *p, int n);
 
 void wpdp_free(void *p);
 
+/**
+ * 内存统计
+ *
+ * 各缓存与缓冲区在分配和释放时按用途 (WPDP_MEMORY_*) 记账，所有数据堆共用同一组
+ * 计数。超过 wpdp_set_memory_limit() 设置的上限时，缓存在增长之前先淘汰自身的内容
+ */
+void wpdp_memory_charge(int component, int64_t size);
+void wpdp_memory_uncharge(int component, int64_t size);
+bool wpdp_memory_exceeded(void);
+
+/**
+ * 内存区 (arena)
+ *
+ * 按块分配内存，分配时只移动指针，不能单独释放。用于生存期限于一次查询、一次
+ * 迭代等范围的临时内存: 在范围开始时用 wpdp_arena_mark() 记下位置，结束时用
+ * wpdp_arena_release() 一次释放此后分配的全部内存。第一个块一直保留以便重复使用。
+ */
+typedef struct _WPDP_Arena      WPDP_Arena;
+typedef struct _WPDP_ArenaMark  WPDP_ArenaMark;
+typedef struct _ArenaChunk      ArenaChunk;
+
+#define WPDP_ARENA_CHUNK_SIZE   (64 * 1024)     // 默认的块大小 (64KB)
+
+struct _WPDP_Arena {
+    ArenaChunk  *chunk;     // 当前块 (最新分配的块)
+    uint8_t     *ptr;       // 当前块中下一个可用的位置
+    uint8_t     *end;       // 当前块的结尾
+    int         chunk_size;
+};
+
+struct _WPDP_ArenaMark {
+    ArenaChunk  *chunk;
+    uint8_t     *ptr;
+};
+
+#define wpdp_arena_new_zero(arena, struct_type, n_structs)   \
+    ((struct_type*)wpdp_arena_alloc_zero(arena, (int)sizeof(struct_type) * n_structs))
+
+void wpdp_arena_init(WPDP_Arena *arena, int chunk_size);
+void *wpdp_arena_alloc(WPDP_Arena *arena, int n);
+void *wpdp_arena_alloc_zero(WPDP_Arena *arena, int n);
+WPDP_ArenaMark wpdp_arena_mark(WPDP_Arena *arena);
+void wpdp_arena_release(WPDP_Arena *arena, WPDP_ArenaMark mark);
+void wpdp_arena_destroy(WPDP_Arena *arena);
+
+/**
+ * 定长对象池
+ *
+ * 从按 alignment 对齐的大块 (slab) 中分配大小相同的对象，释放的对象放入空闲链表
+ * 供下次分配重复使用。所有对象都释放后可以用 wpdp_pool_trim() 把大块交还给系统。
+ * alignment 为页大小时分配的缓冲区可以直接用于 O_DIRECT 读取或与映射的内存交换
+ *
+ * 内存按大块记账 (而不是按使用中的对象)，空闲链表中的对象同样计入
+ */
+typedef struct _WPDP_Pool   WPDP_Pool;
+
+struct _WPDP_Pool {
+    void        *free_list;     // 已释放的对象 (对象的开头保存下一个对象的指针)
+    void        *slabs;         // 已分配的大块 (大块的开头保存前一个大块的指针)
+    uint8_t     *ptr;           // 当前大块中下一个未使用的对象
+    uint8_t     *end;           // 当前大块的结尾
+    int         object_size;    // 对象大小 (已按 alignment 向上取整)
+    int         alignment;
+    int         slab_objects;   // 每个大块中的对象数量
+    int         live;           // 已分配而尚未放回的对象数量
+    int         component;      // 记账的用途 (WPDP_MEMORY_*)，为 WPDP_POOL_NO_CHARGE 时不记账
+};
+
+#define WPDP_POOL_NO_CHARGE     -1
+
+void wpdp_pool_init(WPDP_Pool *pool, int object_size, int alignment, int slab_objects, int component);
+void *wpdp_pool_alloc(WPDP_Pool *pool);
+void *wpdp_pool_alloc_zero(WPDP_Pool *pool);
+void wpdp_pool_free(WPDP_Pool *pool, void *p);
+void wpdp_pool_trim(WPDP_Pool *pool);
+void wpdp_pool_destroy(WPDP_Pool *pool);
+
 #endif // _MALLOC_H_
@@ -1,24 +1,77 @@
 #include "internal.h"
 
+#define _DIRECTORY_INIT_CAPACITY    256
+#define _POOL_SLAB_OBJECTS          64
+
+typedef struct _SectionMetadataCustom Custom;
+
+// Metadata.php: class WPDP_Metadata extends WPDP_Common
+struct _SectionMetadataCustom {
+    int64_t     *_directory;        // 各元数据的偏移量 (按在文件中的顺序)，第一次使用时建立
+    int         _directory_count;
+    int         _directory_capacity;
+    bool        _directory_built;
+    WPDP_Pool   _packet_pool;       // PacketMetadata 的对象池
+};
+
+static int _build_directory(Section *sect);
+static int _directory_search(Custom *custom, int64_t offset);
+static int _window_read(Section *sect, WPDP_MetadataWindow *window, int64_t offset, WPDP_Mutex *io_lock);
+
 int section_metadata_open(WPIO_Stream *stream, WPDP_OpenMode mode, Section **sect_out) {
     assert(IN_ARRAY_2(mode, WPDP_MODE_READONLY, WPDP_MODE_READWRITE));
 
     int rc = section_init(SECTION_TYPE_METADATA, stream, mode, sect_out);
     RETURN_VAL_IF_NON_ZERO(rc);
 
-    (*sect_out)->custom = NULL;
+    Custom *custom = wpdp_new_zero(Custom, 1);
+    wpdp_pool_init(&custom->_packet_pool, sizeof(PacketMetadata), sizeof(int64_t), _POOL_SLAB_OBJECTS,
+                   WPDP_MEMORY_METADATA_CACHE);
+
+    (*sect_out)->custom = custom;
 
     return WPDP_OK;
 }
 
+/**
+ * 关闭元数据区域，释放偏移量目录与对象池
+ */
+void section_metadata_close(Section *sect) {
+    Custom *custom = (Custom *)sect->custom;
+
+    section_metadata_shrink(sect);
+    wpdp_pool_destroy(&custom->_packet_pool);
+
+    wpdp_free(custom);
+    section_free(sect);
+}
+
+/**
+ * 释放偏移量目录，下次按序号访问时重新建立。没有使用中的元数据时同时释放对象池的内存
+ */
+void section_metadata_shrink(Section *sect) {
+    Custom *custom = (Custom *)sect->custom;
+
+    wpdp_memory_uncharge(WPDP_MEMORY_METADATA_CACHE, (int64_t)sizeof(int64_t) * custom->_directory_capacity);
+    wpdp_free(custom->_directory);
+
+    custom->_directory = NULL;
+    custom->_directory_count = 0;
+    custom->_directory_capacity = 0;
+    custom->_directory_built = false;
+
+    wpdp_pool_trim(&custom->_packet_pool);
+}
+
 int64_t section_metadata_get_section_length(Section *sect) {
     return sect->_section->length;
 }
 
 int section_metadata_get_metadata(Section *sect, int64_t offset, PacketMetadata **p_metadata_out) {
+    Custom *custom = (Custom *)sect->custom;
     PacketMetadata *p_metadata;
 
-    p_metadata = wpdp_new_zero(PacketMetadata, 1);
+    p_metadata = wpdp_pool_alloc_zero(&custom->_packet_pool);
 
     section_seek(sect, offset, SEEK_SET, _RELATIVE);
 
@@ -30,6 +83,18 @@ int section_metadata_get_metadata(Section *sect, int64_t offset, PacketMetadata
     return WPDP_OK;
 }
 
+/**
+ * 释放 section_metadata_get_* 返回的元数据包
+ *
+ * 元数据本身不再需要时应先将 p_metadata->metadata 置为 NULL (例如已被条目接管)
+ */
+void section_metadata_release(Section *sect, PacketMetadata *p_metadata) {
+    Custom *custom = (Custom *)sect->custom;
+
+    wpdp_free(p_metadata->metadata);
+    wpdp_pool_free(&custom->_packet_pool, p_metadata);
+}
+
 int section_metadata_get_first(Section *sect, PacketMetadata **p_metadata_out) {
     if (sect->_section->ofsFirst == 0) {
         return WPDP_ERROR;
@@ -46,3 +111,362 @@ int section_metadata_get_next(Section *sect, PacketMetadata *p_current, PacketMe
 
     return section_metadata_get_metadata(sect, offset_next, p_next_out);
 }
+
+/**
+ * 获取第一个元数据的偏移量
+ *
+ * @return 偏移量，没有任何元数据时返回 0
+ */
+int64_t section_metadata_get_first_offset(Section *sect) {
+    return sect->_section->ofsFirst;
+}
+
+/**
+ * 读取指定偏移量的元数据，内存从内存区中分配
+ *
+ * @param offset        元数据的偏移量
+ * @param arena         内存区
+ * @param metadata_out  元数据 (只含实际内容，不含块结尾的填充)
+ */
+int section_metadata_read_metadata(Section *sect, int64_t offset, WPDP_Arena *arena,
+                                   StructMetadata **metadata_out) {
+    StructMetadata header;
+    StructMetadata *metadata;
+
+    section_seek(sect, offset, SEEK_SET, _RELATIVE);
+    section_read(sect, &header, (int)sizeof(StructMetadata));
+
+    if (header.signature != METADATA_SIGNATURE
+        || header.lenActual < (int32_t)sizeof(StructMetadata) || header.lenActual > header.lenBlock) {
+        error_set_msg("Broken metadata at offset 0x%llX", (long long)offset);
+        return WPDP_ERROR_FILE_BROKEN;
+    }
+
+    metadata = wpdp_arena_alloc(arena, header.lenActual);
+    memcpy(metadata, &header, sizeof(StructMetadata));
+    section_read(sect, metadata->blob, header.lenActual - (int)sizeof(StructMetadata));
+
+    *metadata_out = metadata;
+
+    return WPDP_OK;
+}
+
+/**
+ * 从指定偏移量开始读取一段连续的元数据区域 (用于窗口模式的迭代器)
+ *
+ * @param offset      开始读取的偏移量
+ * @param buffer      缓冲区
+ * @param length      最多读取的长度
+ * @param length_out  实际读取的长度 (不超过区域的结尾)
+ */
+int section_metadata_read_window(Section *sect, int64_t offset, void *buffer, int length, int *length_out) {
+    int64_t length_left = sect->_section->length - offset;
+
+    if (length_left < length) {
+        length = (length_left > 0) ? (int)length_left : 0;
+    }
+
+    section_seek(sect, offset, SEEK_SET, _RELATIVE);
+    section_read(sect, buffer, length);
+
+    *length_out = length;
+
+    return WPDP_OK;
+}
+
+/**
+ * 在窗口中取得指定偏移量的元数据
+ *
+ * 该元数据不完全在窗口中时，从该元数据开始重新读取整个窗口。元数据比窗口还大时
+ * 扩大窗口。返回之前检查元数据的头部，并保证 lenActual 与 lenBlock 都在区域与
+ * 窗口之内，调用者可以按 lenActual 访问元数据的内容
+ *
+ * @param window        窗口
+ * @param offset        元数据的偏移量
+ * @param io_lock       读取区域时使用的锁 (多个线程共用同一区域时)，可以为 NULL
+ * @param metadata_out  元数据，指向窗口中的数据，只在下次读取该窗口之前有效
+ */
+int section_metadata_load_window(Section *sect, WPDP_MetadataWindow *window, int64_t offset,
+                                 WPDP_Mutex *io_lock, StructMetadata **metadata_out) {
+    int64_t length_left = sect->_section->length - offset;
+    StructMetadata *metadata;
+    int rc;
+
+    if (offset < window->offset || offset + (int64_t)sizeof(StructMetadata) > window->offset + window->length) {
+        rc = _window_read(sect, window, offset, io_lock);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    metadata = (StructMetadata *)(window->buffer + (offset - window->offset));
+
+    // 块长度受区域剩余长度的限制，损坏的 lenBlock 不会导致分配过大的窗口
+    if (window->offset + window->length - offset < (int64_t)sizeof(StructMetadata)
+        || metadata->signature != METADATA_SIGNATURE
+        || metadata->lenActual < (int32_t)sizeof(StructMetadata) || metadata->lenActual > metadata->lenBlock
+        || metadata->lenBlock > length_left) {
+        error_set_msg("Broken metadata at offset 0x%llX", (long long)offset);
+        return WPDP_ERROR_FILE_BROKEN;
+    }
+
+    if (offset + metadata->lenBlock > window->offset + window->length) {
+        int len_block = metadata->lenBlock;
+
+        if (len_block > window->capacity) {
+            window->buffer = wpdp_realloc(window->buffer, len_block);
+            wpdp_memory_charge(WPDP_MEMORY_BUFFERS, len_block - window->capacity);
+            window->capacity = len_block;
+        }
+
+        rc = _window_read(sect, window, offset, io_lock);
+        RETURN_VAL_IF_NON_ZERO(rc);
+
+        metadata = (StructMetadata *)window->buffer;
+        if (window->length < len_block) {
+            error_set_msg("Broken metadata at offset 0x%llX", (long long)offset);
+            return WPDP_ERROR_FILE_BROKEN;
+        }
+    }
+
+    *metadata_out = metadata;
+
+    return WPDP_OK;
+}
+
+/**
+ * 从指定偏移量开始重新读取整个窗口
+ */
+static int _window_read(Section *sect, WPDP_MetadataWindow *window, int64_t offset, WPDP_Mutex *io_lock) {
+    int rc;
+
+    if (io_lock != NULL) {
+        wpdp_mutex_lock(io_lock);
+    }
+    rc = section_metadata_read_window(sect, offset, window->buffer, window->capacity, &window->length);
+    if (io_lock != NULL) {
+        wpdp_mutex_unlock(io_lock);
+    }
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    window->offset = offset;
+
+    return WPDP_OK;
+}
+
+/**
+ * 查找从指定偏移量开始的第一个元数据 (用于并行扫描时划分区域)
+ *
+ * 已经建立偏移量目录时直接在目录中查找，结果是精确的。否则依次检查各个块的开头
+ * 是否为有效的元数据头部，元数据的 blob 中恰好含有类似头部的数据时可能找到错误
+ * 的位置，调用者需要用前一部分的扫描结果进行验证
+ *
+ * @param offset        开始查找的偏移量
+ * @param boundary_out  元数据的偏移量，不存在时为区域的长度
+ */
+int section_metadata_find_boundary(Section *sect, int64_t offset, int64_t *boundary_out) {
+    Custom *custom = (Custom *)sect->custom;
+    int64_t ofs_first = sect->_section->ofsFirst;
+    int64_t length = sect->_section->length;
+    StructMetadata header;
+
+    if (ofs_first == 0 || offset >= length) {
+        *boundary_out = length;
+        return WPDP_OK;
+    }
+
+    if (offset <= ofs_first) {
+        *boundary_out = ofs_first;
+        return WPDP_OK;
+    }
+
+    if (custom->_directory_built) {
+        int low = 0, high = custom->_directory_count;
+
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (custom->_directory[middle] < offset) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        *boundary_out = (low < custom->_directory_count) ? custom->_directory[low] : length;
+        return WPDP_OK;
+    }
+
+    // 元数据都按块对齐
+    offset = ofs_first + (offset - ofs_first + METADATA_BLOCK_SIZE - 1) / METADATA_BLOCK_SIZE * METADATA_BLOCK_SIZE;
+
+    while (offset + (int64_t)sizeof(StructMetadata) <= length) {
+        section_seek(sect, offset, SEEK_SET, _RELATIVE);
+        section_read(sect, &header, (int)sizeof(StructMetadata));
+
+        if (header.signature == METADATA_SIGNATURE
+            && header.lenBlock > 0 && header.lenBlock % METADATA_BLOCK_SIZE == 0
+            && header.lenActual >= (int32_t)sizeof(StructMetadata) && header.lenActual <= header.lenBlock
+            && offset + header.lenBlock <= length) {
+            *boundary_out = offset;
+            return WPDP_OK;
+        }
+
+        offset += METADATA_BLOCK_SIZE;
+    }
+
+    *boundary_out = length;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取指定元数据之前的一个元数据
+ *
+ * 元数据中没有指向前一个元数据的偏移量，所以使用偏移量目录
+ */
+int section_metadata_get_prev(Section *sect, PacketMetadata *p_current, PacketMetadata **p_prev_out) {
+    Custom *custom = (Custom *)sect->custom;
+
+    int rc = _build_directory(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    int index = _directory_search(custom, p_current->offset);
+    if (index <= 0) {
+        return WPDP_ERROR;
+    }
+
+    return section_metadata_get_metadata(sect, custom->_directory[index - 1], p_prev_out);
+}
+
+/**
+ * 获取元数据 (条目) 的数量
+ *
+ * @param count_out  元数据的数量
+ */
+int section_metadata_get_count(Section *sect, int64_t *count_out) {
+    Custom *custom = (Custom *)sect->custom;
+
+    int rc = _build_directory(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *count_out = custom->_directory_count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取第 n 个元数据的偏移量 (从 0 开始)
+ *
+ * @param n           序号
+ * @param offset_out  偏移量
+ */
+int section_metadata_get_offset_at(Section *sect, int64_t n, int64_t *offset_out) {
+    Custom *custom = (Custom *)sect->custom;
+
+    int rc = _build_directory(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    if (n < 0 || n >= custom->_directory_count) {
+        error_set_msg("Entry %lld out of bounds (%d entries)", (long long)n, custom->_directory_count);
+        return WPDP_ERROR_OUT_OF_BOUNDS;
+    }
+
+    *offset_out = custom->_directory[n];
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取指定偏移量的元数据的序号
+ *
+ * @param offset     元数据的偏移量
+ * @param index_out  序号 (从 0 开始)
+ */
+int section_metadata_get_index_of(Section *sect, int64_t offset, int64_t *index_out) {
+    Custom *custom = (Custom *)sect->custom;
+
+    int rc = _build_directory(sect);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    int index = _directory_search(custom, offset);
+    if (index < 0) {
+        error_set_msg("No metadata at offset 0x%llX", (long long)offset);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    *index_out = index;
+
+    return WPDP_OK;
+}
+
+/**
+ * 建立元数据的偏移量目录
+ *
+ * 依次读取所有元数据的头部 (不读取 blob)，记录各元数据的偏移量。只在第一次需要
+ * 按序号访问时建立一次，之后按序号访问与反向遍历都不再需要逐个读取
+ */
+static int _build_directory(Section *sect) {
+    Custom *custom = (Custom *)sect->custom;
+
+    if (custom->_directory_built) {
+        return WPDP_OK;
+    }
+
+    int64_t offset = sect->_section->ofsFirst;
+
+    // 上次建立时中途出错，重新开始
+    custom->_directory_count = 0;
+
+    while (offset != 0 && offset < sect->_section->length) {
+        StructMetadata *metadata = NULL;
+        int rc;
+
+        section_seek(sect, offset, SEEK_SET, _RELATIVE);
+        rc = struct_read_metadata(sect->_stream, &metadata, true);
+        if (rc != WPDP_OK || metadata->lenBlock <= 0) {
+            wpdp_free(metadata);
+            error_set_msg("Broken metadata at offset 0x%llX", (long long)offset);
+            return WPDP_ERROR_FILE_BROKEN;
+        }
+
+        if (custom->_directory_count == custom->_directory_capacity) {
+            int capacity = (custom->_directory_capacity == 0)
+                         ? _DIRECTORY_INIT_CAPACITY : custom->_directory_capacity * 2;
+            custom->_directory = wpdp_realloc(custom->_directory, (int)sizeof(int64_t) * capacity);
+            wpdp_memory_charge(WPDP_MEMORY_METADATA_CACHE,
+                               (int64_t)sizeof(int64_t) * (capacity - custom->_directory_capacity));
+            custom->_directory_capacity = capacity;
+        }
+
+        custom->_directory[custom->_directory_count] = offset;
+        custom->_directory_count++;
+
+        offset += metadata->lenBlock;
+        wpdp_free(metadata);
+    }
+
+    custom->_directory_built = true;
+
+    return WPDP_OK;
+}
+
+/**
+ * 在偏移量目录中查找指定偏移量的位置
+ *
+ * @return 位置，不存在时返回 -1
+ */
+static int _directory_search(Custom *custom, int64_t offset) {
+    int low = 0, high = custom->_directory_count - 1;
+
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+
+        if (custom->_directory[middle] < offset) {
+            low = middle + 1;
+        } else if (custom->_directory[middle] > offset) {
+            high = middle - 1;
+        } else {
+            return middle;
+        }
+    }
+
+    return -1;
+}
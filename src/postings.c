@@ -0,0 +1,93 @@
+#include "internal.h"
+
+/**
+ * 压缩的偏移量列表 (posting list)
+ *
+ * 用于重复键很多的索引 (INDEX_OPTION_POSTINGS) 的叶子结点，每个键只保存一次，
+ * 其后为该键在本结点中的所有值 (元数据的偏移量，升序)。格式:
+ *
+ *   uint32 numOffsets | int64 first | control[(numOffsets + 2) / 4] | data
+ *
+ * 第一个值之后的各值保存与前一个值的差，按 stream-vbyte 的方式编码: 每个差值
+ * 占 1 ~ 4 字节 (little-endian)，其字节数减 1 保存在控制字节中 (每个控制字节
+ * 依次保存 4 个差值的长度，每个 2 位，从低位开始)。控制字节与数据分开存放，
+ * 解码时每个值的位置只依赖于控制字节，不需要逐字节判断是否结束。
+ */
+
+#define POSTINGS_HEADER_SIZE    ((int)(sizeof(uint32_t) + sizeof(int64_t)))
+
+/**
+ * 获取偏移量列表中值的数量
+ *
+ * 数量至少为 1，且列表头、控制字节与每个差值至少 1 字节的数据都要在 size 之内
+ *
+ * @param block      偏移量列表
+ * @param size       block 之后可用的字节数
+ * @param count_out  值的数量
+ *
+ * @return 列表不完整或数量无效时返回 WPDP_ERROR_FILE_BROKEN
+ */
+int postings_count(const uint8_t *block, int size, int *count_out) {
+    uint32_t count;
+
+    if (size < POSTINGS_HEADER_SIZE) {
+        error_set_msg("Posting list header exceeds the node (%d bytes available)", size);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    memcpy(&count, block, sizeof(uint32_t));
+
+    // 控制字节数为 (count + 2) / 4，数据至少为 count - 1 字节
+    int64_t size_min = (int64_t)POSTINGS_HEADER_SIZE + ((int64_t)count + 2) / 4 + ((int64_t)count - 1);
+    if (count == 0 || size_min > size) {
+        error_set_msg("Invalid posting list length %u (%d bytes available)", count, size);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    *count_out = (int)count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 解码偏移量列表
+ *
+ * @param block        偏移量列表
+ * @param size         block 之后可用的字节数
+ * @param offsets_out  保存解码后各值的位置，至少能容纳 postings_count() 个值
+ *
+ * @return 数据超出 size 时返回 WPDP_ERROR_FILE_BROKEN
+ */
+int postings_decode(const uint8_t *block, int size, int64_t *offsets_out) {
+    int64_t value;
+    int count, i;
+
+    int rc = postings_count(block, size, &count);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    memcpy(&value, block + sizeof(uint32_t), sizeof(int64_t));
+    offsets_out[0] = value;
+
+    const uint8_t *control = block + POSTINGS_HEADER_SIZE;
+    const uint8_t *data = control + (count + 2) / 4;
+    const uint8_t *end = block + size;
+
+    for (i = 1; i < count; i++) {
+        int shift = ((i - 1) & 3) * 2;
+        int len = ((control[(i - 1) >> 2] >> shift) & 3) + 1;
+        uint32_t delta = 0;
+
+        if (len > end - data) {
+            error_set_msg("Posting list data exceeds the node at value %d of %d", i, count);
+            return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+        }
+
+        memcpy(&delta, data, (size_t)len);
+        data += len;
+
+        value += delta;
+        offsets_out[i] = value;
+    }
+
+    return WPDP_OK;
+}
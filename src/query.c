@@ -0,0 +1,740 @@
+#include "internal.h"
+
+typedef struct _PostingList     PostingList;
+typedef struct _QueryCondition  QueryCondition;
+
+#define _SCAN_WINDOW_SIZE   (1024 * 1024)   // 扫描全部元数据时的窗口大小 (1MB)
+
+// 元数据偏移量的有序列表 (升序，无重复)
+struct _PostingList {
+    int64_t     *offsets;
+    int         count;
+};
+
+// 预处理后的查询条件
+struct _QueryCondition {
+    WPDP_String     name;       // 属性名 (指向调用者的字符串)
+    WPDP_String     value;      // 属性值 (指向调用者的字符串)
+    bool            negate;     // 是否取反
+    bool            indexed;    // 该属性是否存在索引
+    PostingList     list;       // 存在索引时，索引中找到的偏移量
+};
+
+static int _prepare_conditions(WPDP *dp, const WPDP_Condition *conds, int n, QueryCondition **qconds_out);
+static void _free_conditions(QueryCondition *qconds, int n);
+
+static void _sort_unique(PostingList *list);
+static int _offset_compare(const void *a, const void *b);
+static int _gallop(const int64_t *offsets, int lo, int count, int64_t desired);
+static void _intersect(PostingList *dst, const PostingList *src);
+static void _subtract(PostingList *dst, const PostingList *src);
+static void _unite(PostingList *dst, const PostingList *src);
+
+static bool _match(StructMetadata *metadata, QueryCondition *qcond);
+static int _scan(WPDP *dp, QueryCondition *qconds, int n, bool any, PostingList *result);
+static int _verify(WPDP *dp, QueryCondition *qconds, int n, PostingList *candidates);
+
+static WPDP_Entries *_entries_create(WPDP *dp, PostingList *list);
+static WPDP_String *_string_or_null(const char *str, WPDP_String *buffer);
+
+/**
+ * 复合查询，所有条件都满足 (AND)
+ *
+ * 各个存在索引的条件先从索引中取得有序的偏移量列表，按长度从小到大依次求交集，
+ * 取反的条件从结果中减去。只有不存在索引的条件才需要读取候选条目的元数据进行
+ * 检查。没有任何不取反且存在索引的条件时，只能扫描全部元数据。
+ *
+ * @param conds        条件数组
+ * @param n            条件数量
+ * @param entries_out  符合条件的条目
+ */
+WPDP_API int wpdp_query_all(WPDP *dp, const WPDP_Condition *conds, int n, WPDP_Entries **entries_out) {
+    assert(n > 0);
+
+    QueryCondition *qconds;
+    PostingList result = {NULL, 0};
+    bool need_verify = false;
+    int i, rc;
+
+    rc = _prepare_conditions(dp, conds, n, &qconds);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    // 找出最短的一个不取反的索引列表作为初始结果
+    int first = -1;
+    for (i = 0; i < n; i++) {
+        if (qconds[i].indexed && !qconds[i].negate
+            && (first == -1 || qconds[i].list.count < qconds[first].list.count)) {
+            first = i;
+        }
+        if (!qconds[i].indexed) {
+            need_verify = true;
+        }
+    }
+
+    if (first == -1) {
+        rc = _scan(dp, qconds, n, false, &result);
+        _free_conditions(qconds, n);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        *entries_out = _entries_create(dp, &result);
+        return WPDP_OK;
+    }
+
+    result = qconds[first].list;
+    qconds[first].list.offsets = NULL;
+    qconds[first].list.count = 0;
+
+    // 结果只会越来越短，所以总是遍历结果并在另一个列表中跳跃查找
+    for (i = 0; i < n && result.count > 0; i++) {
+        if (i != first && qconds[i].indexed && !qconds[i].negate) {
+            _intersect(&result, &qconds[i].list);
+        }
+    }
+
+    for (i = 0; i < n && result.count > 0; i++) {
+        if (qconds[i].indexed && qconds[i].negate) {
+            _subtract(&result, &qconds[i].list);
+        }
+    }
+
+    if (need_verify && result.count > 0) {
+        rc = _verify(dp, qconds, n, &result);
+    }
+
+    _free_conditions(qconds, n);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *entries_out = _entries_create(dp, &result);
+
+    return WPDP_OK;
+}
+
+/**
+ * 复合查询，任一条件满足 (OR)
+ *
+ * 所有条件都不取反且存在索引时，直接合并各索引的偏移量列表，否则扫描全部元数据
+ *
+ * @param conds        条件数组
+ * @param n            条件数量
+ * @param entries_out  符合条件的条目
+ */
+WPDP_API int wpdp_query_any(WPDP *dp, const WPDP_Condition *conds, int n, WPDP_Entries **entries_out) {
+    assert(n > 0);
+
+    QueryCondition *qconds;
+    PostingList result = {NULL, 0};
+    bool need_scan = false;
+    int i, rc;
+
+    rc = _prepare_conditions(dp, conds, n, &qconds);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    for (i = 0; i < n; i++) {
+        if (!qconds[i].indexed || qconds[i].negate) {
+            need_scan = true;
+        }
+    }
+
+    if (need_scan) {
+        rc = _scan(dp, qconds, n, true, &result);
+    } else {
+        for (i = 0; i < n; i++) {
+            _unite(&result, &qconds[i].list);
+        }
+    }
+
+    _free_conditions(qconds, n);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *entries_out = _entries_create(dp, &result);
+
+    return WPDP_OK;
+}
+
+/**
+ * 在分词索引中查找含有所有给定词的条目 (如 "标题包含 X")
+ *
+ * 给定的文本按索引的分词方式分割为词，各个词的偏移量列表按长度从小到大依次
+ * 求交集，不需要读取任何条目的元数据
+ *
+ * @param attr_name    属性名
+ * @param text         要查找的词 (可以有多个，以空白字符或标点符号分隔)
+ * @param entries_out  含有所有词的条目
+ */
+WPDP_API int wpdp_query_tokens(WPDP *dp, const char *attr_name, const char *text, WPDP_Entries **entries_out) {
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    WPDP_String name, value;
+    WPDP_String *tokens;
+    PostingList *lists;
+    PostingList result = {NULL, 0};
+    uint8_t flags;
+    int count, i, rc;
+
+    rc = section_indexes_get_token_flags(dp->_indexes, _string_or_null(attr_name, &name), &flags);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    wpdp_string_tokenize(_string_or_null(text, &value), flags, &tokens, &count);
+
+    if (count == 0) {
+        wpdp_free(tokens);
+        error_set_msg("No token found in the query text");
+        return WPDP_ERROR_INVALID_ATTRIBUTE_VALUE;
+    }
+
+    lists = wpdp_new_zero(PostingList, count);
+
+    int first = 0;
+    for (i = 0; i < count; i++) {
+        rc = section_indexes_find(dp->_indexes, &name, &tokens[i], &lists[i].offsets, &lists[i].count);
+        if (rc != WPDP_OK) {
+            break;
+        }
+        _sort_unique(&lists[i]);
+        if (lists[i].count < lists[first].count) {
+            first = i;
+        }
+    }
+
+    if (rc == WPDP_OK) {
+        result = lists[first];
+        lists[first].offsets = NULL;
+
+        for (i = 0; i < count && result.count > 0; i++) {
+            if (i != first) {
+                _intersect(&result, &lists[i]);
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        wpdp_free(lists[i].offsets);
+    }
+    wpdp_free(lists);
+    wpdp_free(tokens);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *entries_out = _entries_create(dp, &result);
+
+    return WPDP_OK;
+}
+
+/**
+ * 在覆盖索引中查找指定属性值
+ *
+ * 索引的叶子结点中附带了部分属性的值 (如大小、修改时间)，只需要这些属性时可以
+ * 直接从索引中取得，不需要读取任何条目的元数据。对每个找到的条目调用一次
+ * callback，参数 offset 为条目元数据的偏移量，values 与 wpdp_index_covered()
+ * 返回的属性名一一对应，只在回调期间有效。回调函数中不能对同一数据堆进行查询
+ *
+ * @param attr_name   属性名
+ * @param attr_value  属性值
+ * @param callback    回调函数，返回非 0 值时停止查找并返回该值
+ * @param arg         传递给回调函数的参数
+ */
+WPDP_API int wpdp_query_covering(WPDP *dp, const char *attr_name, const char *attr_value,
+                                 WPDP_CoveringCallback callback, void *arg) {
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    WPDP_String name, value;
+
+    return section_indexes_find_covering(dp->_indexes, _string_or_null(attr_name, &name),
+                                         _string_or_null(attr_value, &value), callback, arg);
+}
+
+/**
+ * 获取覆盖索引中附带的属性名
+ *
+ * @param attr_name  属性名
+ * @param names_out  附带的各属性名 (调用者不应修改或释放)
+ * @param count_out  附带的属性数量，不是覆盖索引时为 0
+ */
+WPDP_API int wpdp_index_covered(WPDP *dp, const char *attr_name, WPDP_String **names_out, int *count_out) {
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    WPDP_String name;
+
+    return section_indexes_get_covered(dp->_indexes, _string_or_null(attr_name, &name), names_out, count_out);
+}
+
+/**
+ * 统计属性值在指定范围内的条目数量
+ *
+ * 只能用于计数的 B+ 树索引，不需要读取范围内的条目，所需时间与范围的大小无关
+ *
+ * @param attr_name  属性名
+ * @param lo         属性值的下界 (含)，为 NULL 时无下界
+ * @param hi         属性值的上界 (含)，为 NULL 时无上界
+ * @param count_out  条目数量
+ */
+WPDP_API int wpdp_query_count(WPDP *dp, const char *attr_name, const char *lo, const char *hi,
+                              int64_t *count_out) {
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    WPDP_String name, value_lo, value_hi;
+
+    return section_indexes_count(dp->_indexes, _string_or_null(attr_name, &name),
+                                 _string_or_null(lo, &value_lo), _string_or_null(hi, &value_hi),
+                                 count_out);
+}
+
+/**
+ * 按属性值的顺序分页取得指定范围内的条目
+ *
+ * 只能用于计数的 B+ 树索引。返回的条目按属性值排序 (不是按偏移量排序)，
+ * 跳过的条目不需要读取
+ *
+ * @param attr_name    属性名
+ * @param lo           属性值的下界 (含)，为 NULL 时无下界
+ * @param hi           属性值的上界 (含)，为 NULL 时无上界
+ * @param skip         跳过的条目数量
+ * @param limit        最多取得的条目数量
+ * @param entries_out  取得的条目
+ */
+WPDP_API int wpdp_query_range(WPDP *dp, const char *attr_name, const char *lo, const char *hi,
+                              int64_t skip, int limit, WPDP_Entries **entries_out) {
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (skip < 0 || limit < 0) {
+        error_set_msg("Invalid skip %lld or limit %d", (long long)skip, limit);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    WPDP_String name, value_lo, value_hi;
+    PostingList result = {NULL, 0};
+    int rc;
+
+    rc = section_indexes_select(dp->_indexes, _string_or_null(attr_name, &name),
+                                _string_or_null(lo, &value_lo), _string_or_null(hi, &value_hi),
+                                skip, limit, &result.offsets, &result.count);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *entries_out = _entries_create(dp, &result);
+
+    return WPDP_OK;
+}
+
+/**
+ * 批量查找同一属性的多个属性值
+ *
+ * 所有属性值在索引中一起查找，每个结点最多只读取一次，适合一次查找大量的 ID。
+ * 对每个属性值调用一次 callback (顺序不保证与 keys 相同)，参数 index 为该属性值
+ * 在 keys 中的下标，offsets 为找到的条目元数据的偏移量，只在回调期间有效
+ *
+ * @param attr_name  属性名
+ * @param keys       各属性值
+ * @param n          属性值的数量
+ * @param callback   回调函数，返回非 0 值时停止查找并返回该值
+ * @param arg        传递给回调函数的参数
+ */
+WPDP_API int wpdp_query_many(WPDP *dp, const char *attr_name, const char **keys, int n,
+                             WPDP_QueryCallback callback, void *arg) {
+    assert(n >= 0);
+
+    if (dp->_indexes == NULL) {
+        error_set_msg("The data pile has no indexes");
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    WPDP_String name;
+    WPDP_String *values;
+    int i, rc;
+
+    name = wpdp_string_view(attr_name, (int)strlen(attr_name));
+
+    values = wpdp_new_zero(WPDP_String, n);
+    for (i = 0; i < n; i++) {
+        values[i] = wpdp_string_view(keys[i], (int)strlen(keys[i]));
+    }
+
+    rc = section_indexes_find_many(dp->_indexes, &name, values, n, callback, arg);
+
+    wpdp_free(values);
+
+    return rc;
+}
+
+WPDP_API int wpdp_entries_free(WPDP_Entries *entries) {
+    wpdp_free(entries->offsets);
+    wpdp_free(entries);
+
+    return WPDP_OK;
+}
+
+/**
+ * 预处理查询条件，并从索引中取得各条件的偏移量列表
+ */
+static int _prepare_conditions(WPDP *dp, const WPDP_Condition *conds, int n, QueryCondition **qconds_out) {
+    QueryCondition *qconds;
+    int i, rc;
+
+    qconds = wpdp_new_zero(QueryCondition, n);
+    if (qconds == NULL) {
+        return WPDP_ERROR;
+    }
+
+    for (i = 0; i < n; i++) {
+        QueryCondition *qcond = &qconds[i];
+
+        qcond->name = wpdp_string_view(conds[i].name, (int)strlen(conds[i].name));
+        qcond->value = wpdp_string_view(conds[i].value, (int)strlen(conds[i].value));
+        qcond->negate = conds[i].negate;
+        qcond->indexed = false;
+
+        if (dp->_indexes == NULL) {
+            continue;
+        }
+
+        // 分词索引中的键是属性值中的各个词，不能用于整个属性值的比较，按未索引的条件处理
+        if (section_indexes_is_tokenized(dp->_indexes, &qcond->name)) {
+            continue;
+        }
+
+        rc = section_indexes_find(dp->_indexes, &qcond->name, &qcond->value,
+                                  &qcond->list.offsets, &qcond->list.count);
+        if (rc == WPDP_ERROR_INVALID_ATTRIBUTE_NAME) {
+            continue;
+        } else if (rc != WPDP_OK) {
+            _free_conditions(qconds, i);
+            return rc;
+        }
+
+        qcond->indexed = true;
+        _sort_unique(&qcond->list);
+    }
+
+    *qconds_out = qconds;
+
+    return WPDP_OK;
+}
+
+static void _free_conditions(QueryCondition *qconds, int n) {
+    int i;
+
+    for (i = 0; i < n; i++) {
+        wpdp_free(qconds[i].list.offsets);
+    }
+
+    wpdp_free(qconds);
+}
+
+/**
+ * 对偏移量列表排序并去除重复项
+ *
+ * 同一个键的元素在叶子结点中按插入顺序排列，通常已经是升序的
+ */
+static void _sort_unique(PostingList *list) {
+    int i, j;
+
+    for (i = 1; i < list->count; i++) {
+        if (list->offsets[i - 1] > list->offsets[i]) {
+            qsort(list->offsets, (size_t)list->count, sizeof(int64_t), _offset_compare);
+            break;
+        }
+    }
+
+    for (i = 1, j = 1; i < list->count; i++) {
+        if (list->offsets[i] != list->offsets[j - 1]) {
+            list->offsets[j++] = list->offsets[i];
+        }
+    }
+
+    if (list->count > 0) {
+        list->count = j;
+    }
+}
+
+/**
+ * 比较两个偏移量 (用于 qsort)
+ */
+static int _offset_compare(const void *a, const void *b) {
+    int64_t offset_a = *(const int64_t *)a;
+    int64_t offset_b = *(const int64_t *)b;
+
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+/**
+ * 从指定位置开始跳跃查找第一个不小于指定值的位置
+ *
+ * 先以 1, 2, 4, ... 的步长向后跳跃，确定范围后再二分查找。查找位置总是向后
+ * 移动，所以求交集的开销与较短列表的长度成正比，而不是与较长列表的长度成正比。
+ *
+ * @param offsets  偏移量列表
+ * @param lo       开始查找的位置
+ * @param count    列表长度
+ * @param desired  要查找的值
+ *
+ * @return 位置，所有值都小于 desired 时返回 count
+ */
+static int _gallop(const int64_t *offsets, int lo, int count, int64_t desired) {
+    int hi = lo;
+    int step = 1;
+
+    while (hi < count && offsets[hi] < desired) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+
+    if (hi > count) {
+        hi = count;
+    }
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (offsets[mid] < desired) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * 求交集，结果保存在 dst 中
+ */
+static void _intersect(PostingList *dst, const PostingList *src) {
+    int i, j = 0, k = 0;
+
+    for (i = 0; i < dst->count && j < src->count; i++) {
+        j = _gallop(src->offsets, j, src->count, dst->offsets[i]);
+        if (j < src->count && src->offsets[j] == dst->offsets[i]) {
+            dst->offsets[k++] = dst->offsets[i];
+        }
+    }
+
+    dst->count = k;
+}
+
+/**
+ * 求差集，结果保存在 dst 中
+ */
+static void _subtract(PostingList *dst, const PostingList *src) {
+    int i, j = 0, k = 0;
+
+    for (i = 0; i < dst->count; i++) {
+        j = _gallop(src->offsets, j, src->count, dst->offsets[i]);
+        if (j >= src->count || src->offsets[j] != dst->offsets[i]) {
+            dst->offsets[k++] = dst->offsets[i];
+        }
+    }
+
+    dst->count = k;
+}
+
+/**
+ * 求并集，结果保存在 dst 中
+ */
+static void _unite(PostingList *dst, const PostingList *src) {
+    int64_t *merged;
+    int i = 0, j = 0, k = 0;
+
+    if (src->count == 0) {
+        return;
+    }
+
+    merged = wpdp_malloc_zero((int)sizeof(int64_t) * (dst->count + src->count));
+
+    while (i < dst->count && j < src->count) {
+        if (dst->offsets[i] < src->offsets[j]) {
+            merged[k++] = dst->offsets[i++];
+        } else if (dst->offsets[i] > src->offsets[j]) {
+            merged[k++] = src->offsets[j++];
+        } else {
+            merged[k++] = dst->offsets[i++];
+            j++;
+        }
+    }
+    while (i < dst->count) {
+        merged[k++] = dst->offsets[i++];
+    }
+    while (j < src->count) {
+        merged[k++] = src->offsets[j++];
+    }
+
+    wpdp_free(dst->offsets);
+    dst->offsets = merged;
+    dst->count = k;
+}
+
+/**
+ * 检查元数据是否满足指定条件
+ */
+static bool _match(StructMetadata *metadata, QueryCondition *qcond) {
+    WPDP_String value;
+    bool matched;
+
+    matched = (struct_get_metadata_attribute(metadata, &qcond->name, &value) == WPDP_OK
+               && wpdp_string_compare(&value, &qcond->value) == 0);
+
+    return (matched != qcond->negate);
+}
+
+/**
+ * 扫描全部元数据，找出满足条件的条目
+ *
+ * @param any  为 true 时任一条件满足即可，否则需要所有条件都满足
+ */
+static int _scan(WPDP *dp, QueryCondition *qconds, int n, bool any, PostingList *result) {
+    WPDP_Iterator *iterator;
+    int capacity = 0;
+    int i;
+
+    result->offsets = NULL;
+    result->count = 0;
+
+    // 使用窗口模式的迭代器，不为每个条目分配内存
+    int rc = wpdp_iterator_init_windowed(dp, _SCAN_WINDOW_SIZE, &iterator);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    while (iterator->current != NULL) {
+        bool matched = !any;
+
+        for (i = 0; i < n; i++) {
+            if (_match(iterator->current->metadata, &qconds[i]) == any) {
+                matched = any;
+                break;
+            }
+        }
+
+        if (matched) {
+            if (result->count == capacity) {
+                capacity = (capacity == 0) ? 16 : capacity * 2;
+                result->offsets = wpdp_realloc(result->offsets, (int)sizeof(int64_t) * capacity);
+            }
+            result->offsets[result->count++] = iterator->current->offset;
+        }
+
+        rc = wpdp_iterator_next(iterator);
+        if (rc != WPDP_OK) {
+            break;
+        }
+    }
+
+    wpdp_iterator_free(iterator);
+
+    return (rc == WPDP_ERROR_OUT_OF_BOUNDS) ? WPDP_OK : rc;
+}
+
+/**
+ * 读取候选条目的元数据，检查不存在索引的条件，结果保存在 candidates 中
+ *
+ * 每个候选条目的元数据在检查完后即释放，只占用一个元数据的临时内存
+ */
+static int _verify(WPDP *dp, QueryCondition *qconds, int n, PostingList *candidates) {
+    WPDP_ArenaMark mark = wpdp_arena_mark(&dp->_scratch);
+    StructMetadata *metadata;
+    int i, j, k = 0;
+    int rc = WPDP_OK;
+
+    for (i = 0; i < candidates->count; i++) {
+        bool matched = true;
+
+        rc = section_metadata_read_metadata(dp->_metadata, candidates->offsets[i], &dp->_scratch, &metadata);
+        if (rc != WPDP_OK) {
+            break;
+        }
+
+        for (j = 0; j < n; j++) {
+            if (!qconds[j].indexed && !_match(metadata, &qconds[j])) {
+                matched = false;
+                break;
+            }
+        }
+
+        if (matched) {
+            candidates->offsets[k++] = candidates->offsets[i];
+        }
+
+        wpdp_arena_release(&dp->_scratch, mark);
+    }
+
+    wpdp_arena_release(&dp->_scratch, mark);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    candidates->count = k;
+
+    return WPDP_OK;
+}
+
+/**
+ * 把 C 字符串包装为 WPDP_String (不复制)
+ *
+ * @return str 为 NULL 时返回 NULL，否则返回 buffer
+ */
+static WPDP_String *_string_or_null(const char *str, WPDP_String *buffer) {
+    if (str == NULL) {
+        return NULL;
+    }
+
+    *buffer = wpdp_string_view(str, (int)strlen(str));
+
+    return buffer;
+}
+
+static WPDP_Entries *_entries_create(WPDP *dp, PostingList *list) {
+    WPDP_Entries *entries;
+
+    entries = wpdp_new_zero(WPDP_Entries, 1);
+
+    entries->dp = dp;
+    entries->offsets = list->offsets;
+    entries->count = list->count;
+    entries->position = 0;
+
+    return entries;
+}
+
+#ifdef WPDP_TEST
+/**
+ * 测试用: 调用 _gallop()
+ */
+int test_query_gallop(const int64_t *offsets, int lo, int count, int64_t desired) {
+    return _gallop(offsets, lo, count, desired);
+}
+
+/**
+ * 测试用: 调用 _intersect()，结果保存在 dst 中
+ *
+ * @return 结果的数量
+ */
+int test_query_intersect(int64_t *dst, int dst_count, const int64_t *src, int src_count) {
+    PostingList list_dst = { dst, dst_count };
+    PostingList list_src = { (int64_t *)src, src_count };
+
+    _intersect(&list_dst, &list_src);
+
+    return list_dst.count;
+}
+
+/**
+ * 测试用: 调用 _subtract()，结果保存在 dst 中
+ *
+ * @return 结果的数量
+ */
+int test_query_subtract(int64_t *dst, int dst_count, const int64_t *src, int src_count) {
+    PostingList list_dst = { dst, dst_count };
+    PostingList list_src = { (int64_t *)src, src_count };
+
+    _subtract(&list_dst, &list_src);
+
+    return list_dst.count;
+}
+#endif
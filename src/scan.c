@@ -0,0 +1,732 @@
+#include "internal.h"
+#include "thread.h"
+
+/**
+ * 带谓词的扫描
+ *
+ * 表达式树先编译为前序排列的结点数组，属性名去重后各占一个槽位。扫描时用窗口
+ * 模式的迭代器顺序读取元数据，谓词直接在原始元数据上求值: 只涉及头部字段的
+ * 条件不解析属性，涉及属性的条件在第一次需要时遍历一次属性，取得所有槽位的值。
+ * 不满足谓词的条目不会创建 WPDP_Entry。
+ *
+ * 并行扫描时把元数据区域按字节划分为若干部分，各部分的开头对齐到之后的第一个
+ * 元数据。各线程有自己的窗口，读取时共用一个互斥锁 (流不是线程安全的)，谓词的
+ * 求值是并行的。
+ */
+
+typedef struct _PredicateNode   PredicateNode;
+typedef struct _ScanContext     ScanContext;
+typedef struct _ScanShared      ScanShared;
+typedef struct _ScanPartition   ScanPartition;
+
+#define _SCAN_WINDOW_SIZE       (4 * 1024 * 1024)   // 扫描时的窗口大小 (4MB)
+#define _PARALLEL_WINDOW_SIZE   (1024 * 1024)       // 并行扫描时各线程的窗口大小 (1MB)
+#define _PARALLEL_MAX_THREADS   64
+
+// 编译后的表达式结点
+struct _PredicateNode {
+    WPDP_ExprType   type;
+    int             slot;       // 属性值的槽位 (仅用于属性条件)
+    WPDP_String     value;      // EQUAL、PREFIX 的值，RANGE 的下限
+    WPDP_String     hi;         // RANGE 的上限
+    bool            has_lo;
+    bool            has_hi;
+    int64_t         min;        // SIZE 的下限
+    int64_t         max;        // SIZE 的上限
+    int             count;      // 子结点数量 (仅用于 AND、OR、NOT)
+    int             end;        // 该结点子树之后的第一个结点的序号
+};
+
+struct _WPDP_Predicate {
+    PredicateNode   *nodes;
+    int             node_count;
+    WPDP_String     *names;     // 各槽位的属性名
+    int             name_count;
+    uint8_t         *strings;   // 所有字符串的存储空间
+};
+
+// 对一个条目求值时的状态
+struct _ScanContext {
+    const WPDP_Predicate    *pred;
+    StructMetadata          *metadata;
+    WPDP_String             *values;    // 各槽位的属性值
+    bool                    *found;     // 各槽位的属性是否存在
+    bool                    resolved;   // 是否已经取得各槽位的属性值
+    int                     error;
+};
+
+// 并行扫描中各线程共用的数据
+struct _ScanShared {
+    WPDP                    *dp;
+    const WPDP_Predicate    *pred;
+    bool                    ordered;
+    WPDP_ScanCallback       callback;
+    void                    *arg;
+    WPDP_Mutex              io_lock;        // 读取元数据区域时使用
+    WPDP_Mutex              callback_lock;  // 不保持顺序时，调用回调函数时使用
+    volatile bool           stopped;        // 回调函数要求停止扫描
+};
+
+// 并行扫描中的一部分
+struct _ScanPartition {
+    ScanShared      *shared;
+    int64_t         start;              // 第一个元数据的偏移量
+    int64_t         end;                // 下一部分的开头，偏移量不小于此值的元数据不属于本部分
+    int64_t         stop;               // 扫描结束时下一个元数据的偏移量
+    int             error;
+    char            error_msg[ERROR_MSG_SIZE];  // 出错时线程中的错误信息，等待结束后再报告
+    WPDP_Thread     thread;
+    bool            running;            // 是否在单独的线程中运行，尚未等待结束
+    bool            direct;             // 保持顺序时是否直接调用回调函数 (只用于第一部分)
+    ScanContext     ctx;
+    WPDP_MetadataWindow window;
+    // 保持顺序时，满足条件的元数据先复制到这里，按部分的顺序调用回调函数
+    uint8_t         *matched;
+    int             matched_length;
+    int             matched_capacity;
+    int64_t         *matched_offsets;
+    int             *matched_positions;
+    int             matched_count;
+    int             matched_count_capacity;
+};
+
+static int _measure(const WPDP_Expr *expr, int *node_count, int *string_length);
+static void _compile(WPDP_Predicate *pred, const WPDP_Expr *expr, uint8_t **strings, int *index);
+static void _copy_string(const char *src, uint8_t **strings, WPDP_String *dst);
+static int _get_slot(WPDP_Predicate *pred, const char *name, uint8_t **strings);
+
+static bool _evaluate(ScanContext *ctx, int index);
+static void _resolve(ScanContext *ctx);
+
+static void _partition_init(ScanPartition *part, ScanShared *shared, int64_t start, int64_t end);
+static void _partition_reset(ScanPartition *part, int64_t start);
+static void _partition_free(ScanPartition *part);
+static void _partition_scan(ScanPartition *part);
+static void _partition_fail(ScanPartition *part, int rc);
+static void _partition_record(ScanPartition *part, StructMetadata *metadata, int64_t offset);
+static void _partition_deliver(ScanPartition *part);
+static void _partition_join(ScanPartition *part);
+
+/**
+ * 编译谓词
+ *
+ * 表达式中的字符串会被复制，编译完成后表达式可以释放
+ *
+ * @param expr      表达式
+ * @param pred_out  编译后的谓词，使用完毕后用 wpdp_predicate_free() 释放
+ */
+WPDP_API int wpdp_predicate_compile(const WPDP_Expr *expr, WPDP_Predicate **pred_out) {
+    WPDP_Predicate *pred;
+    int node_count = 0;
+    int string_length = 0;
+    uint8_t *strings;
+    int index = 0;
+
+    int rc = _measure(expr, &node_count, &string_length);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    pred = wpdp_new_zero(WPDP_Predicate, 1);
+    pred->nodes = wpdp_new_zero(PredicateNode, node_count);
+    pred->names = wpdp_new_zero(WPDP_String, node_count);
+    pred->strings = wpdp_malloc_zero(string_length + 1);
+
+    strings = pred->strings;
+    _compile(pred, expr, &strings, &index);
+    pred->node_count = index;
+
+    *pred_out = pred;
+
+    return WPDP_OK;
+}
+
+/**
+ * 释放谓词
+ */
+WPDP_API int wpdp_predicate_free(WPDP_Predicate *pred) {
+    wpdp_free(pred->nodes);
+    wpdp_free(pred->names);
+    wpdp_free(pred->strings);
+    wpdp_free(pred);
+
+    return WPDP_OK;
+}
+
+/**
+ * 扫描全部条目，对满足谓词的条目调用回调函数
+ *
+ * 传给回调函数的条目及其属性值只在回调函数返回之前有效
+ *
+ * @param pred      编译后的谓词，为 NULL 时所有条目都满足
+ * @param callback  回调函数，返回非 0 值时停止扫描
+ * @param arg       传给回调函数的参数
+ */
+WPDP_API int wpdp_scan(WPDP *dp, const WPDP_Predicate *pred, WPDP_ScanCallback callback, void *arg) {
+    WPDP_Iterator *iterator;
+    ScanContext ctx;
+    WPDP_Entry entry;
+    int rc;
+
+    rc = wpdp_iterator_init_windowed(dp, _SCAN_WINDOW_SIZE, &iterator);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pred = pred;
+    if (pred != NULL && pred->name_count > 0) {
+        ctx.values = wpdp_new_zero(WPDP_String, pred->name_count);
+        ctx.found = wpdp_new_zero(bool, pred->name_count);
+    }
+
+    while (iterator->current != NULL) {
+        bool matched = true;
+
+        if (pred != NULL) {
+            ctx.metadata = iterator->current->metadata;
+            ctx.resolved = false;
+            matched = _evaluate(&ctx, 0);
+            if (ctx.error != WPDP_OK) {
+                rc = ctx.error;
+                break;
+            }
+        }
+
+        if (matched) {
+            memset(&entry, 0, sizeof(entry));
+            entry.dp = dp;
+            entry.metadata = iterator->current->metadata;
+            entry.offset = iterator->current->offset;
+
+            if (callback(arg, &entry) != 0) {
+                break;
+            }
+        }
+
+        rc = wpdp_iterator_next(iterator);
+        if (rc == WPDP_ERROR_OUT_OF_BOUNDS) {
+            rc = WPDP_OK;
+            break;
+        }
+        if (rc != WPDP_OK) {
+            break;
+        }
+    }
+
+    wpdp_free(ctx.values);
+    wpdp_free(ctx.found);
+    wpdp_iterator_free(iterator);
+
+    return rc;
+}
+
+WPDP_THREAD_PROC(_partition_proc, arg) {
+    _partition_scan((ScanPartition *)arg);
+
+    WPDP_THREAD_RETURN;
+}
+
+/**
+ * 用多个线程并行扫描全部条目，对满足谓词的条目调用回调函数
+ *
+ * 保持顺序时，第一部分的线程直接调用回调函数，其余各部分满足条件的元数据先复制
+ * 到内存中，在前面的部分结束后按条目的顺序调用回调函数。复制的元数据在调用回调
+ * 函数之前一直保留，最多约为元数据区域的 (threads - 1) / threads (谓词为 NULL
+ * 时)，计入 WPDP_MEMORY_BUFFERS。这时各部分的开头如果是通过检查块的开头找到的，
+ * 会与前一部分扫描结束的位置核对，不一致的部分从前一部分结束的位置重新扫描。
+ * 不保持顺序时，先建立偏移量目录，各线程直接调用回调函数 (同一时刻只有一个线程
+ * 在调用)，不占用额外的内存。
+ *
+ * 传给回调函数的条目及其属性值只在回调函数返回之前有效
+ *
+ * @param pred      编译后的谓词，为 NULL 时所有条目都满足
+ * @param threads   线程数量
+ * @param ordered   是否按条目的顺序调用回调函数
+ * @param callback  回调函数，返回非 0 值时停止扫描
+ * @param arg       传给回调函数的参数
+ */
+WPDP_API int wpdp_scan_parallel(WPDP *dp, const WPDP_Predicate *pred, int threads, bool ordered,
+                                WPDP_ScanCallback callback, void *arg) {
+    Section *sect = dp->_metadata;
+    ScanShared shared;
+    ScanPartition *parts;
+    int64_t ofs_first = section_metadata_get_first_offset(sect);
+    int64_t length = section_metadata_get_section_length(sect);
+    int64_t *starts;
+    int rc = WPDP_OK;
+    int i;
+
+    if (threads <= 1 || ofs_first == 0) {
+        return wpdp_scan(dp, pred, callback, arg);
+    }
+    if (threads > _PARALLEL_MAX_THREADS) {
+        threads = _PARALLEL_MAX_THREADS;
+    }
+
+    if (!ordered) {
+        int64_t count;
+        rc = section_metadata_get_count(sect, &count);
+        RETURN_VAL_IF_NON_ZERO(rc);
+    }
+
+    memset(&shared, 0, sizeof(shared));
+    shared.dp = dp;
+    shared.pred = pred;
+    shared.ordered = ordered;
+    shared.callback = callback;
+    shared.arg = arg;
+    wpdp_mutex_init(&shared.io_lock);
+    wpdp_mutex_init(&shared.callback_lock);
+
+    // 划分区域，各部分的开头对齐到之后的第一个元数据
+    starts = wpdp_new_zero(int64_t, threads + 1);
+    starts[0] = ofs_first;
+    starts[threads] = length;
+    for (i = 1; i < threads; i++) {
+        int64_t offset = ofs_first + (length - ofs_first) / threads * i;
+        if (offset < starts[i - 1]) {
+            offset = starts[i - 1];
+        }
+        rc = section_metadata_find_boundary(sect, offset, &starts[i]);
+        if (rc != WPDP_OK) {
+            break;
+        }
+    }
+
+    if (rc != WPDP_OK) {
+        wpdp_free(starts);
+        wpdp_mutex_destroy(&shared.io_lock);
+        wpdp_mutex_destroy(&shared.callback_lock);
+        return rc;
+    }
+
+    parts = wpdp_new_zero(ScanPartition, threads);
+    for (i = 0; i < threads; i++) {
+        _partition_init(&parts[i], &shared, starts[i], starts[i + 1]);
+    }
+    wpdp_free(starts);
+
+    // 第一部分之前没有其它部分，保持顺序时也可以直接调用回调函数
+    parts[0].direct = true;
+
+    for (i = 0; i < threads; i++) {
+        parts[i].running = wpdp_thread_create(&parts[i].thread, _partition_proc, &parts[i]);
+        if (!parts[i].running) {
+            _partition_scan(&parts[i]);
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        _partition_join(&parts[i]);
+
+        if (rc != WPDP_OK || shared.stopped) {
+            continue;
+        }
+        if (parts[i].error != WPDP_OK) {
+            rc = parts[i].error;
+            error_set_msg("%s", parts[i].error_msg);
+            shared.stopped = true;
+            continue;
+        }
+
+        if (ordered) {
+            _partition_deliver(&parts[i]);
+
+            // 下一部分的开头不是真正的元数据，从本部分结束的位置重新扫描
+            if (i + 1 < threads && parts[i].stop != parts[i + 1].start) {
+                _partition_join(&parts[i + 1]);
+                _partition_reset(&parts[i + 1], parts[i].stop);
+                _partition_scan(&parts[i + 1]);
+            }
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        _partition_free(&parts[i]);
+    }
+    wpdp_free(parts);
+
+    wpdp_mutex_destroy(&shared.io_lock);
+    wpdp_mutex_destroy(&shared.callback_lock);
+
+    return rc;
+}
+
+/**
+ * 计算编译表达式所需的结点数量和字符串长度，同时检查表达式
+ */
+static int _measure(const WPDP_Expr *expr, int *node_count, int *string_length) {
+    int i;
+
+    (*node_count)++;
+
+    switch (expr->type) {
+        case WPDP_EXPR_AND:
+        case WPDP_EXPR_OR:
+        case WPDP_EXPR_NOT:
+            if (expr->count <= 0 || (expr->type == WPDP_EXPR_NOT && expr->count != 1)) {
+                error_set_msg("Invalid number of operands: %d", expr->count);
+                return WPDP_ERROR_INVALID_ARGUMENT;
+            }
+            for (i = 0; i < expr->count; i++) {
+                int rc = _measure(&expr->children[i], node_count, string_length);
+                RETURN_VAL_IF_NON_ZERO(rc);
+            }
+            return WPDP_OK;
+        case WPDP_EXPR_SIZE:
+        case WPDP_EXPR_COMPRESSION:
+            return WPDP_OK;
+        case WPDP_EXPR_EQUAL:
+        case WPDP_EXPR_PREFIX:
+        case WPDP_EXPR_RANGE:
+        case WPDP_EXPR_EXISTS:
+            break;
+        default:
+            error_set_msg("Invalid expression type: %d", expr->type);
+            return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (expr->name == NULL || ((IN_ARRAY_2(expr->type, WPDP_EXPR_EQUAL, WPDP_EXPR_PREFIX)) && expr->value == NULL)) {
+        error_set_msg("Missing attribute name or value");
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    *string_length += (int)strlen(expr->name);
+    if (expr->value != NULL) {
+        *string_length += (int)strlen(expr->value);
+    }
+    if (expr->hi != NULL) {
+        *string_length += (int)strlen(expr->hi);
+    }
+
+    return WPDP_OK;
+}
+
+/**
+ * 把表达式按前序编译到结点数组中
+ *
+ * @param strings  字符串存储空间中下一个可用的位置
+ * @param index    下一个可用的结点序号
+ */
+static void _compile(WPDP_Predicate *pred, const WPDP_Expr *expr, uint8_t **strings, int *index) {
+    PredicateNode *node = &pred->nodes[(*index)++];
+    int i;
+
+    node->type = expr->type;
+
+    switch (expr->type) {
+        case WPDP_EXPR_AND:
+        case WPDP_EXPR_OR:
+        case WPDP_EXPR_NOT:
+            node->count = expr->count;
+            for (i = 0; i < expr->count; i++) {
+                _compile(pred, &expr->children[i], strings, index);
+            }
+            break;
+        case WPDP_EXPR_SIZE:
+            node->min = expr->min;
+            node->max = expr->max;
+            break;
+        case WPDP_EXPR_COMPRESSION:
+            node->min = expr->compression;
+            break;
+        default:
+            node->slot = _get_slot(pred, expr->name, strings);
+            node->has_lo = (expr->value != NULL);
+            node->has_hi = (expr->hi != NULL);
+            if (node->has_lo) {
+                _copy_string(expr->value, strings, &node->value);
+            }
+            if (node->has_hi) {
+                _copy_string(expr->hi, strings, &node->hi);
+            }
+            break;
+    }
+
+    node->end = *index;
+}
+
+static void _copy_string(const char *src, uint8_t **strings, WPDP_String *dst) {
+    int len = (int)strlen(src);
+
+    memcpy(*strings, src, (size_t)len);
+    *dst = wpdp_string_view(*strings, len);
+    *strings += len;
+}
+
+/**
+ * 取得属性名的槽位，相同的属性名共用一个槽位
+ */
+static int _get_slot(WPDP_Predicate *pred, const char *name, uint8_t **strings) {
+    int len = (int)strlen(name);
+    int i;
+
+    for (i = 0; i < pred->name_count; i++) {
+        if (pred->names[i].len == len && memcmp(pred->names[i].str, name, (size_t)len) == 0) {
+            return i;
+        }
+    }
+
+    _copy_string(name, strings, &pred->names[pred->name_count]);
+
+    return pred->name_count++;
+}
+
+/**
+ * 对序号为 index 的结点求值 (AND、OR 短路求值)
+ */
+static bool _evaluate(ScanContext *ctx, int index) {
+    PredicateNode *node = &ctx->pred->nodes[index];
+    WPDP_String *value;
+    int i, child;
+
+    switch (node->type) {
+        case WPDP_EXPR_AND:
+            for (i = 0, child = index + 1; i < node->count; i++, child = ctx->pred->nodes[child].end) {
+                if (!_evaluate(ctx, child)) {
+                    return false;
+                }
+            }
+            return true;
+        case WPDP_EXPR_OR:
+            for (i = 0, child = index + 1; i < node->count; i++, child = ctx->pred->nodes[child].end) {
+                if (_evaluate(ctx, child)) {
+                    return true;
+                }
+            }
+            return false;
+        case WPDP_EXPR_NOT:
+            return !_evaluate(ctx, index + 1);
+        case WPDP_EXPR_SIZE:
+            return (ctx->metadata->lenOriginal >= node->min && ctx->metadata->lenOriginal <= node->max);
+        case WPDP_EXPR_COMPRESSION:
+            return (ctx->metadata->compression == node->min);
+        default:
+            break;
+    }
+
+    if (!ctx->resolved) {
+        _resolve(ctx);
+    }
+
+    if (!ctx->found[node->slot]) {
+        return false;
+    }
+
+    value = &ctx->values[node->slot];
+
+    switch (node->type) {
+        case WPDP_EXPR_EXISTS:
+            return true;
+        case WPDP_EXPR_EQUAL:
+            return (value->len == node->value.len
+                    && memcmp(WPDP_STRING_PTR(value), node->value.str, (size_t)value->len) == 0);
+        case WPDP_EXPR_PREFIX:
+            return (value->len >= node->value.len
+                    && memcmp(WPDP_STRING_PTR(value), node->value.str, (size_t)node->value.len) == 0);
+        case WPDP_EXPR_RANGE:
+            return ((!node->has_lo || wpdp_string_compare(value, &node->value) >= 0)
+                    && (!node->has_hi || wpdp_string_compare(value, &node->hi) <= 0));
+        default:
+            return false;
+    }
+}
+
+/**
+ * 遍历一次元数据的属性，取得各槽位的属性值
+ */
+static void _resolve(ScanContext *ctx) {
+    const WPDP_Predicate *pred = ctx->pred;
+    WPDP_String name, value;
+    int remaining = pred->name_count;
+    int pos = 0;
+    int rc = WPDP_OK;
+    int i;
+
+    memset(ctx->found, 0, sizeof(bool) * (size_t)pred->name_count);
+
+    while (remaining > 0
+           && (rc = struct_next_metadata_attribute(ctx->metadata, &pos, &name, &value)) == WPDP_OK) {
+        for (i = 0; i < pred->name_count; i++) {
+            if (!ctx->found[i] && pred->names[i].len == name.len
+                && memcmp(pred->names[i].str, name.str, (size_t)name.len) == 0) {
+                ctx->values[i] = value;
+                ctx->found[i] = true;
+                remaining--;
+                break;
+            }
+        }
+    }
+
+    if (remaining > 0 && rc != WPDP_ERROR_OUT_OF_BOUNDS) {
+        ctx->error = rc;
+    }
+
+    ctx->resolved = true;
+}
+
+static void _partition_init(ScanPartition *part, ScanShared *shared, int64_t start, int64_t end) {
+    part->shared = shared;
+    part->start = start;
+    part->end = end;
+    part->stop = start;
+    part->error = WPDP_OK;
+
+    part->ctx.pred = shared->pred;
+    if (shared->pred != NULL && shared->pred->name_count > 0) {
+        part->ctx.values = wpdp_new_zero(WPDP_String, shared->pred->name_count);
+        part->ctx.found = wpdp_new_zero(bool, shared->pred->name_count);
+    }
+
+    part->window.buffer = wpdp_malloc_zero(_PARALLEL_WINDOW_SIZE);
+    part->window.capacity = _PARALLEL_WINDOW_SIZE;
+    wpdp_memory_charge(WPDP_MEMORY_BUFFERS, part->window.capacity);
+}
+
+/**
+ * 丢弃已有的结果，使该部分从新的位置开始
+ */
+static void _partition_reset(ScanPartition *part, int64_t start) {
+    part->start = start;
+    part->stop = start;
+    part->error = WPDP_OK;
+    part->ctx.error = WPDP_OK;
+    part->window.offset = 0;
+    part->window.length = 0;
+    part->matched_length = 0;
+    part->matched_count = 0;
+}
+
+static void _partition_free(ScanPartition *part) {
+    wpdp_free(part->ctx.values);
+    wpdp_free(part->ctx.found);
+    wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, part->window.capacity);
+    wpdp_free(part->window.buffer);
+    wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, part->matched_capacity
+                         + (int64_t)(sizeof(int64_t) + sizeof(int)) * part->matched_count_capacity);
+    wpdp_free(part->matched);
+    wpdp_free(part->matched_offsets);
+    wpdp_free(part->matched_positions);
+}
+
+static void _partition_join(ScanPartition *part) {
+    if (part->running) {
+        wpdp_thread_join(part->thread);
+        part->running = false;
+    }
+}
+
+/**
+ * 扫描一部分的元数据
+ */
+static void _partition_scan(ScanPartition *part) {
+    ScanShared *shared = part->shared;
+    int64_t offset = part->start;
+
+    while (offset < part->end && !shared->stopped) {
+        StructMetadata *metadata;
+        bool matched = true;
+
+        int rc = section_metadata_load_window(shared->dp->_metadata, &part->window, offset,
+                                              &shared->io_lock, &metadata);
+        if (rc != WPDP_OK) {
+            _partition_fail(part, rc);
+            break;
+        }
+
+        if (shared->pred != NULL) {
+            part->ctx.metadata = metadata;
+            part->ctx.resolved = false;
+            matched = _evaluate(&part->ctx, 0);
+            if (part->ctx.error != WPDP_OK) {
+                _partition_fail(part, part->ctx.error);
+                break;
+            }
+        }
+
+        if (matched) {
+            if (shared->ordered && !part->direct) {
+                _partition_record(part, metadata, offset);
+            } else {
+                WPDP_Entry entry;
+
+                memset(&entry, 0, sizeof(entry));
+                entry.dp = shared->dp;
+                entry.metadata = metadata;
+                entry.offset = offset;
+
+                wpdp_mutex_lock(&shared->callback_lock);
+                if (!shared->stopped && shared->callback(shared->arg, &entry) != 0) {
+                    shared->stopped = true;
+                }
+                wpdp_mutex_unlock(&shared->callback_lock);
+            }
+        }
+
+        offset += metadata->lenBlock;
+    }
+
+    part->stop = offset;
+}
+
+/**
+ * 记录该部分的错误
+ *
+ * 错误信息保存在当前线程的缓冲区中，复制到该部分，由调用者在等待线程结束后报告
+ */
+static void _partition_fail(ScanPartition *part, int rc) {
+    part->error = rc;
+    snprintf(part->error_msg, sizeof(part->error_msg), "%s", error_get_msg());
+}
+
+/**
+ * 复制满足条件的元数据，保持顺序时使用
+ */
+static void _partition_record(ScanPartition *part, StructMetadata *metadata, int64_t offset) {
+    // 按 8 字节对齐，使复制后的元数据可以直接访问
+    int size = (metadata->lenActual + 7) & ~7;
+
+    if (part->matched_length + size > part->matched_capacity) {
+        int capacity = (part->matched_capacity == 0) ? _PARALLEL_WINDOW_SIZE : part->matched_capacity * 2;
+        while (capacity < part->matched_length + size) {
+            capacity *= 2;
+        }
+        part->matched = wpdp_realloc(part->matched, capacity);
+        wpdp_memory_charge(WPDP_MEMORY_BUFFERS, capacity - part->matched_capacity);
+        part->matched_capacity = capacity;
+    }
+
+    if (part->matched_count == part->matched_count_capacity) {
+        int capacity = (part->matched_count_capacity == 0) ? 256 : part->matched_count_capacity * 2;
+        part->matched_offsets = wpdp_realloc(part->matched_offsets, (int)sizeof(int64_t) * capacity);
+        part->matched_positions = wpdp_realloc(part->matched_positions, (int)sizeof(int) * capacity);
+        wpdp_memory_charge(WPDP_MEMORY_BUFFERS,
+                           (int64_t)(sizeof(int64_t) + sizeof(int)) * (capacity - part->matched_count_capacity));
+        part->matched_count_capacity = capacity;
+    }
+
+    memcpy(part->matched + part->matched_length, metadata, (size_t)metadata->lenActual);
+
+    part->matched_offsets[part->matched_count] = offset;
+    part->matched_positions[part->matched_count] = part->matched_length;
+    part->matched_count++;
+    part->matched_length += size;
+}
+
+/**
+ * 对该部分复制的元数据依次调用回调函数，保持顺序时使用
+ */
+static void _partition_deliver(ScanPartition *part) {
+    ScanShared *shared = part->shared;
+    WPDP_Entry entry;
+    int i;
+
+    for (i = 0; i < part->matched_count; i++) {
+        memset(&entry, 0, sizeof(entry));
+        entry.dp = shared->dp;
+        entry.metadata = (StructMetadata *)(part->matched + part->matched_positions[i]);
+        entry.offset = part->matched_offsets[i];
+
+        if (shared->callback(shared->arg, &entry) != 0) {
+            shared->stopped = true;
+            break;
+        }
+    }
+}
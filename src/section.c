@@ -36,6 +36,15 @@ int section_init(uint8_t sect_type, WPIO_Stream *stream,
     return WPDP_OK;
 }
 
+/**
+ * 释放区域对象 (各区域的附加信息由各自的 close 函数释放)
+ */
+void section_free(Section *sect) {
+    wpdp_free(sect->_header);
+    wpdp_free(sect->_section);
+    wpdp_free(sect);
+}
+
 WPIO_Stream *section_get_stream(Section *sect) {
     return sect->_stream;
 }
@@ -1,4 +1,5 @@
 #include "internal.h"
+#include <ctype.h>
 
 WPDP_String_Builder *wpdp_string_builder_create(int init_capacity) {
     WPDP_String_Builder *builder = wpdp_new_zero(WPDP_String_Builder, 1);
@@ -44,19 +45,63 @@ int wpdp_string_builder_free(WPDP_String_Builder *builder) {
     return WPDP_OK;
 }
 
+/**
+ * 把数据复制到字符串中
+ *
+ * 短于 WPDP_STRING_INLINE_SIZE 的数据保存在结构体内部，不分配内存。数据之后
+ * 总是有结尾的 '\0'
+ *
+ * @param str   字符串 (原有的内容不释放)
+ * @param data  数据
+ * @param len   数据长度
+ */
+int wpdp_string_init(WPDP_String *str, const void *data, int len) {
+    str->len = len;
+
+    if (len < WPDP_STRING_INLINE_SIZE) {
+        str->mode = WPDP_STRING_INLINE;
+        memcpy(str->buf, data, (size_t)len);
+        str->buf[len] = '\0';
+        return WPDP_OK;
+    }
+
+    str->mode = WPDP_STRING_OWNED;
+    str->str = wpdp_malloc_zero(len + 1);
+    if (str->str == NULL) {
+        str->mode = WPDP_STRING_BORROWED;
+        str->len = 0;
+        return WPDP_ERROR;
+    }
+    memcpy(str->str, data, (size_t)len);
+
+    return WPDP_OK;
+}
+
+/**
+ * 释放字符串拥有的内存，并置为借用模式的空字符串
+ *
+ * 借用模式与内联模式的字符串不需要释放，也可以调用
+ */
+void wpdp_string_clear(WPDP_String *str) {
+    if (str->mode == WPDP_STRING_OWNED) {
+        wpdp_free(str->str);
+    }
+
+    str->len = 0;
+    str->mode = WPDP_STRING_BORROWED;
+    str->str = NULL;
+}
+
 WPDP_String *wpdp_string_direct(void *str, int len) {
     WPDP_String *wpdp_str = wpdp_new_zero(WPDP_String, 1);
-    wpdp_str->len = len;
-    wpdp_str->str = str;
+    *wpdp_str = wpdp_string_view(str, len);
 
     return wpdp_str;
 }
 
 WPDP_String *wpdp_string_create(const char *str, int len) {
     WPDP_String *wpdp_str = wpdp_new_zero(WPDP_String, 1);
-    wpdp_str->len = len;
-    wpdp_str->str = wpdp_malloc_zero(len + 1);
-    memcpy(wpdp_str->str, str, (size_t)len);
+    wpdp_string_init(wpdp_str, str, len);
 
     return wpdp_str;
 }
@@ -66,7 +111,7 @@ WPDP_String *wpdp_string_from_cstr(const char *str) {
 }
 
 int wpdp_string_compare(WPDP_String *str_1, WPDP_String *str_2) {
-    int retval = memcmp(str_1->str, str_2->str,
+    int retval = memcmp(WPDP_STRING_PTR(str_1), WPDP_STRING_PTR(str_2),
         (size_t)((str_1->len < str_2->len) ? str_1->len : str_2->len));
 
     if (retval) {
@@ -76,8 +121,89 @@ int wpdp_string_compare(WPDP_String *str_1, WPDP_String *str_2) {
     }
 }
 
+/**
+ * 计算字符串的哈希值 (32 位 FNV-1a)
+ */
+uint32_t wpdp_string_hash(WPDP_String *str) {
+    const uint8_t *p = (const uint8_t *)WPDP_STRING_PTR(str);
+    uint32_t hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < str->len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * 计算字符串的 64 位哈希值 (64 位 FNV-1a)
+ *
+ * 该哈希值会被保存在文件中 (如过滤器)，不能更改算法
+ */
+uint64_t wpdp_string_hash64(WPDP_String *str) {
+    const uint8_t *p = (const uint8_t *)WPDP_STRING_PTR(str);
+    uint64_t hash = 14695981039346656037ull;
+    int i;
+
+    for (i = 0; i < str->len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+/**
+ * 把字符串分割为词
+ *
+ * 返回的数组与各个词的数据在同一块内存中，用 wpdp_free() 释放数组即可
+ *
+ * @param text        字符串
+ * @param flags       分词标记 (TOKEN_FLAG_*)
+ * @param tokens_out  各个词，按出现的顺序排列 (可能重复)
+ * @param count_out   词的数量
+ */
+int wpdp_string_tokenize(WPDP_String *text, uint8_t flags, WPDP_String **tokens_out, int *count_out) {
+    const uint8_t *p = (const uint8_t *)WPDP_STRING_PTR(text);
+    int max_count = text->len / 2 + 1;
+    WPDP_String *tokens = wpdp_malloc_zero((int)sizeof(WPDP_String) * max_count + text->len);
+    uint8_t *buffer = (uint8_t *)(tokens + max_count);
+    int count = 0;
+    int i = 0;
+
+    while (i < text->len) {
+        // 跳过分隔符
+        while (i < text->len && p[i] < 0x80 && (isspace(p[i]) || ispunct(p[i]) || iscntrl(p[i]))) {
+            i++;
+        }
+
+        int start = i;
+        while (i < text->len && !(p[i] < 0x80 && (isspace(p[i]) || ispunct(p[i]) || iscntrl(p[i])))) {
+            buffer[i] = ((flags & TOKEN_FLAG_LOWERCASE) && p[i] < 0x80) ? (uint8_t)tolower(p[i]) : p[i];
+            i++;
+        }
+
+        if (i > start && i - start <= TOKEN_MAX_LENGTH) {
+            tokens[count] = wpdp_string_view(buffer + start, i - start);
+            count++;
+        }
+    }
+
+    *tokens_out = tokens;
+    *count_out = count;
+
+    return WPDP_OK;
+}
+
+/**
+ * 释放 wpdp_string_create() 等创建的字符串
+ *
+ * 借用模式的字符串 (wpdp_string_direct()) 只释放结构体本身
+ */
 int wpdp_string_free(WPDP_String *str) {
-    wpdp_free(str->str);
+    wpdp_string_clear(str);
     wpdp_free(str);
 
     return WPDP_OK;
@@ -27,7 +27,7 @@
         } \
         if (ptr->lenBlock > (block_size)) { \
             ptr = wpdp_realloc(ptr, ptr->lenBlock); \
-            len = wpio_read((stream), (ptr + (block_size)), ((size_t)ptr->lenBlock - (size_t)(block_size))); \
+            len = wpio_read((stream), ((uint8_t *)ptr + (block_size)), ((size_t)ptr->lenBlock - (size_t)(block_size))); \
         } \
         *(ptr_out) = ptr; \
     } while (0)
@@ -120,10 +120,12 @@ int struct_create_index_table(StructIndexTable **index_table_out) {
     return RETURN_CODE(WPDP_OK);
 }
 
-int struct_create_node(StructNode **node_out) {
+int struct_create_node(int block_size, StructNode **node_out) {
+    assert(block_size >= NODE_BLOCK_SIZE_MIN && block_size <= NODE_BLOCK_SIZE_MAX);
+
     StructNode *node;
 
-    node = wpdp_malloc_zero(NODE_BLOCK_SIZE);
+    node = wpdp_malloc_zero(block_size);
     if (node == NULL) {
         return RETURN_CODE(WPDP_ERROR);
     }
@@ -163,12 +165,25 @@ int struct_read_section(WPIO_Stream *stream, StructSection **section_out) {
     return RETURN_CODE(WPDP_OK);
 }
 
-int struct_read_node(WPIO_Stream *stream, StructNode **node_out) {
-    STRUCT_READ_FIXED(stream, node_out, StructNode);
+/**
+ * 把结点读入调用者提供的缓冲区
+ *
+ * 缓冲区会被完全覆盖，不需要预先清零
+ *
+ * @param node  缓冲区，大小为 block_size
+ */
+int struct_read_node_into(WPIO_Stream *stream, int block_size, StructNode *node) {
+    assert(block_size >= NODE_BLOCK_SIZE_MIN && block_size <= NODE_BLOCK_SIZE_MAX);
+
+    size_t len = wpio_read(stream, node, (size_t)block_size);
+    if (len != (size_t)block_size) {
+        error_set_msg("Failed to read %d bytes (%d bytes read actually)", block_size, (int)len);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
 
-    if ((*node_out)->signature != NODE_SIGNATURE) {
+    if (node->signature != NODE_SIGNATURE) {
         error_set_msg("Unexpected signature 0x%X, expecting 0x%X",
-                      (*node_out)->signature, NODE_SIGNATURE);
+                      node->signature, NODE_SIGNATURE);
         return RETURN_CODE(WPDP_ERROR);
     }
 
@@ -197,7 +212,7 @@ int struct_read_index_table(WPIO_Stream *stream, StructIndexTable **ptr_out, boo
         }
         if (ptr->lenBlock > INDEX_TABLE_BLOCK_SIZE) {
             ptr = wpdp_realloc(ptr, ptr->lenBlock);
-            len = wpio_read(stream, (ptr + INDEX_TABLE_BLOCK_SIZE), ((size_t)ptr->lenBlock - (size_t)INDEX_TABLE_BLOCK_SIZE));
+            len = wpio_read(stream, ((uint8_t *)ptr + INDEX_TABLE_BLOCK_SIZE), ((size_t)ptr->lenBlock - (size_t)INDEX_TABLE_BLOCK_SIZE));
         }
         *ptr_out = ptr;
     } while (0);
@@ -210,6 +225,34 @@ int struct_read_index_table(WPIO_Stream *stream, StructIndexTable **ptr_out, boo
     return RETURN_CODE(WPDP_OK);
 }
 
+int struct_read_filter(WPIO_Stream *stream, StructFilter **ptr_out) {
+    STRUCT_READ_VARIANT(stream, ptr_out, false, StructFilter,
+                        FILTER_SIGNATURE, FILTER_BLOCK_SIZE);
+
+    if ((*ptr_out)->numHash == 0 || (*ptr_out)->numHash > FILTER_MAX_HASH
+        || (*ptr_out)->numBits <= 0
+        || (*ptr_out)->numBits / 8 > (*ptr_out)->lenActual - (int32_t)sizeof(StructFilter)) {
+        error_set_msg("Broken filter (numHash = %d, numBits = %lld)",
+                      (*ptr_out)->numHash, (*ptr_out)->numBits);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    return RETURN_CODE(WPDP_OK);
+}
+
+int struct_read_hash_directory(WPIO_Stream *stream, StructHashDirectory **ptr_out) {
+    STRUCT_READ_VARIANT(stream, ptr_out, false, StructHashDirectory,
+                        HASH_DIRECTORY_SIGNATURE, HASH_DIRECTORY_BLOCK_SIZE);
+
+    if ((*ptr_out)->globalDepth > HASH_MAX_GLOBAL_DEPTH
+        || ((int64_t)8 << (*ptr_out)->globalDepth) > (*ptr_out)->lenActual - (int32_t)sizeof(StructHashDirectory)) {
+        error_set_msg("Broken hash directory (globalDepth = %d)", (*ptr_out)->globalDepth);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    return RETURN_CODE(WPDP_OK);
+}
+
 int struct_write_header(WPIO_Stream *stream, StructHeader *header) {
     STRUCT_WRITE_FIXED(stream, header, StructHeader);
 
@@ -246,6 +289,75 @@ int struct_write_index_table(WPIO_Stream *stream, StructIndexTable *index_table)
     return RETURN_CODE(WPDP_OK);
 }
 
+/**
+ * 在元数据中查找指定名称的属性
+ *
+ * 找到的属性值直接指向元数据的 blob，不另外分配内存
+ *
+ * @param name       属性名
+ * @param value_out  属性值
+ *
+ * @return 指定属性不存在时返回 WPDP_ERROR_INVALID_ATTRIBUTE_NAME
+ */
+int struct_get_metadata_attribute(StructMetadata *metadata, WPDP_String *name, WPDP_String *value_out) {
+    WPDP_String attr_name;
+    int pos = 0;
+    int rc;
+
+    while ((rc = struct_next_metadata_attribute(metadata, &pos, &attr_name, value_out)) == WPDP_OK) {
+        if (attr_name.len == name->len && memcmp(attr_name.str, WPDP_STRING_PTR(name), (size_t)name->len) == 0) {
+            return RETURN_CODE(WPDP_OK);
+        }
+    }
+
+    if (rc != WPDP_ERROR_OUT_OF_BOUNDS) {
+        return rc;
+    }
+
+    return RETURN_CODE(WPDP_ERROR_INVALID_ATTRIBUTE_NAME);
+}
+
+/**
+ * 读取元数据中位于 *pos 处的属性，并把 *pos 移到下一个属性
+ *
+ * 属性名和属性值直接指向元数据的 blob，不另外分配内存
+ *
+ * @param pos        属性在 blob 中的位置，从 0 开始
+ * @param name_out   属性名
+ * @param value_out  属性值
+ *
+ * @return 已经没有更多属性时返回 WPDP_ERROR_OUT_OF_BOUNDS
+ */
+int struct_next_metadata_attribute(StructMetadata *metadata, int *pos,
+                                   WPDP_String *name_out, WPDP_String *value_out) {
+    int length = metadata->lenActual - (int32_t)sizeof(StructMetadata);
+    uint8_t *ptr = metadata->blob + *pos;
+
+    if (*pos >= length) {
+        return WPDP_ERROR_OUT_OF_BOUNDS;
+    }
+
+    if (*pos + ATTRIBUTE_HEADER_SIZE > length || ptr[0] != ATTRIBUTE_SIGNATURE) {
+        error_set_msg("Broken attribute at 0x%X", *pos);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    int len_name = ptr[2];
+    int len_value = *((uint16_t *)(ptr + 3));
+
+    if (*pos + ATTRIBUTE_HEADER_SIZE + len_name + len_value > length) {
+        error_set_msg("Broken attribute at 0x%X", *pos);
+        return RETURN_CODE(WPDP_ERROR_FILE_BROKEN);
+    }
+
+    *name_out = wpdp_string_view(ptr + ATTRIBUTE_HEADER_SIZE, len_name);
+    *value_out = wpdp_string_view(ptr + ATTRIBUTE_HEADER_SIZE + len_name, len_value);
+
+    *pos += ATTRIBUTE_HEADER_SIZE + len_name + len_value;
+
+    return RETURN_CODE(WPDP_OK);
+}
+
 int struct_get_block_length(int block_size, int actual_length) {
     int block_number = (int)ceil((double)actual_length / (double)block_size);
     int block_length = block_size * block_number;
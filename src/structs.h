@@ -6,6 +6,10 @@ typedef struct _StructSection StructSection;
 typedef struct _StructMetadata StructMetadata;
 typedef struct _StructIndexTable StructIndexTable;
 typedef struct _StructNode StructNode;
+typedef struct _StructFilter StructFilter;
+typedef struct _StructHashDirectory StructHashDirectory;
+typedef struct _StructColumnsHeader StructColumnsHeader;
+typedef struct _StructColumn StructColumn;
 
 /**
  * 各类型结构的标识常量 (uint32_t)
@@ -15,16 +19,66 @@ typedef struct _StructNode StructNode;
 #define METADATA_SIGNATURE       0x4154454Du  // 元数据的标识
 #define INDEX_TABLE_SIGNATURE    0x54584449u  // 索引表的标识
 #define NODE_SIGNATURE           0x45444F4Eu  // 结点的标识
+#define FILTER_SIGNATURE         0x544C4946u  // 过滤器的标识
+#define HASH_DIRECTORY_SIGNATURE 0x52494448u  // 哈希索引目录的标识
+#define COLUMNS_SIGNATURE        0x534C4F43u  // 列式导出文件的标识
 
 /**
  * 属性信息的标识常量 (uint8_t)
+ *
+ * 元数据的 blob 中依次存放各属性信息，每个属性信息的格式为:
+ *   signature (uint8) | flags (uint8) | lenName (uint8) | lenValue (uint16) | name | value
  */
 #define ATTRIBUTE_SIGNATURE  0xD5u    // 属性信息的标识
+#define ATTRIBUTE_HEADER_SIZE    5    // 属性信息头部的大小
 
 /**
  * 索引信息的标识常量 (uint8_t)
  */
 #define INDEX_SIGNATURE      0xE1u    // 索引信息的标识
+#define INDEX_OPTION_SIGNATURE   0xE2u    // 索引选项的标识
+
+/**
+ * 索引选项常量 (uint8_t)
+ *
+ * 索引表中的索引选项附加在同名的索引之后，格式为:
+ *   signature (uint8) | option (uint8) | lenName (uint8) | name | lenValue (uint8) | value
+ *
+ * 不认识的选项会被忽略
+ */
+#define INDEX_OPTION_FILTER      0x01u    // 过滤器的偏移量 (int64)
+#define INDEX_OPTION_KEY_TYPE    0x02u    // 键的类型 (uint8, KEY_TYPE_*)
+#define INDEX_OPTION_NODE_SIZE   0x03u    // 结点的块大小 (uint8, 块大小以 2 为底的对数)
+#define INDEX_OPTION_COUNTED     0x04u    // 内部结点含有各子树的元素数量 (无值)
+#define INDEX_OPTION_TOKENS      0x05u    // 分词索引，键为属性值中的各个词 (uint8, TOKEN_FLAG_*)
+#define INDEX_OPTION_POSTINGS    0x06u    // 叶子结点使用压缩的偏移量列表 (无值)
+#define INDEX_OPTION_COVERING    0x07u    // 叶子结点中附带的属性 (uint8 数量, 各属性名 uint8 长度 + 名称)
+
+/**
+ * 分词标记常量 (uint8_t)
+ *
+ * 分词时以 ASCII 空白字符与标点符号分隔，非 ASCII 字节 (如 UTF-8 多字节字符)
+ * 视为词的一部分。超过 255 字节的词不被索引
+ */
+#define TOKEN_FLAG_NONE          0x00u    // 无任何标记
+#define TOKEN_FLAG_LOWERCASE     0x01u    // 把 ASCII 字母转换为小写
+#define TOKEN_MAX_LENGTH         255      // 词的最大长度
+
+/**
+ * 索引键类型常量 (uint8_t)
+ *
+ * 数值类型的键在结点中以定长的 uint64 保存，并转换为保持顺序的编码，
+ * 使所有数值类型都可以直接按无符号整数比较:
+ *   INT64:  翻转符号位
+ *   UINT64: 不变
+ *   DOUBLE: 非负数翻转符号位，负数翻转所有位
+ *
+ * 过滤器与哈希索引使用编码后的 8 字节 (little-endian) 作为键
+ */
+#define KEY_TYPE_STRING          0x00u    // 字节串 (默认)
+#define KEY_TYPE_INT64           0x01u    // 有符号 64 位整数
+#define KEY_TYPE_UINT64          0x02u    // 无符号 64 位整数
+#define KEY_TYPE_DOUBLE          0x03u    // 双精度浮点数
 
 /**
  * 基本块大小常量
@@ -44,7 +98,9 @@ typedef struct _StructNode StructNode;
 #define SECTION_BLOCK_SIZE       (BASE_BLOCK_SIZE * 1)   // 区域信息的块大小
 #define METADATA_BLOCK_SIZE      (BASE_BLOCK_SIZE * 1)   // 元数据的块大小
 #define INDEX_TABLE_BLOCK_SIZE   (BASE_BLOCK_SIZE * 1)   // 索引表的块大小
-#define NODE_BLOCK_SIZE          (BASE_BLOCK_SIZE * 8)   // 索引结点的块大小
+#define NODE_BLOCK_SIZE          (BASE_BLOCK_SIZE * 8)   // 索引结点的默认块大小
+#define FILTER_BLOCK_SIZE        (BASE_BLOCK_SIZE * 1)   // 过滤器的块大小
+#define HASH_DIRECTORY_BLOCK_SIZE    (BASE_BLOCK_SIZE * 1)   // 哈希索引目录的块大小
 
 /**
  * 各类型结构的其他大小常量
@@ -52,6 +108,23 @@ typedef struct _StructNode StructNode;
 #define NODE_DATA_SIZE          (NODE_BLOCK_SIZE - 32)          // 索引结点的数据区域大小
 #define NODE_DATA_SIZE_EXPANDED ((NODE_BLOCK_SIZE * 2) - 32)    // 扩展的块大小
 
+/**
+ * 索引结点块大小的范围
+ *
+ * 每个索引可以使用不同的结点块大小 (INDEX_OPTION_NODE_SIZE)，必须为 2 的幂。
+ * 元素中键字符串的距离为 uint16，所以数据区域不能超过 65535 bytes
+ */
+#define NODE_BLOCK_SIZE_MIN      (BASE_BLOCK_SIZE * 8)   // 4 KB
+#define NODE_BLOCK_SIZE_MAX      (BASE_BLOCK_SIZE * 128) // 64 KB
+
+#define NODE_DATA_SIZE_OF(block_size)           ((block_size) - 32)
+#define NODE_DATA_SIZE_EXPANDED_OF(block_size)  (((block_size) * 2) - 32)
+
+/**
+ * 过滤器参数常量
+ */
+#define FILTER_MAX_HASH          30      // 最大哈希函数数量
+
 /**
  * 头信息数据堆版本常量 (uint16_t)
  */
@@ -132,6 +205,28 @@ typedef struct _StructNode StructNode;
  */
 #define INDEX_TYPE_UNDEFINED     0x00u    // 未定义类型
 #define INDEX_TYPE_BTREE         0x01u    // B+ 树类型
+#define INDEX_TYPE_HASH          0x02u    // 哈希类型 (只支持等值查找)
+
+/**
+ * 哈希索引参数常量
+ */
+#define HASH_MAX_GLOBAL_DEPTH    24      // 目录的最大全局深度 (16M 个桶)
+
+/**
+ * 列式导出文件的常量
+ *
+ * 文件依次为头信息、各列信息、各列名称、各列数据，各列数据按 COLUMNS_ALIGNMENT
+ * 对齐，映射到内存后可以直接作为数组访问。字典编码的列中每行为一个 uint32 编号，
+ * 0 表示该条目没有这个属性，n 表示字典中的第 n 项。字典的格式为:
+ *   offsets (uint32 * (numDict + 1)) | values
+ */
+#define COLUMNS_VERSION          0x0001u
+#define COLUMNS_ALIGNMENT        64      // 各列数据的对齐
+
+#define COLUMN_TYPE_INT64        0x01u    // int64 数组
+#define COLUMN_TYPE_INT32        0x02u    // int32 数组
+#define COLUMN_TYPE_UINT8        0x03u    // uint8 数组
+#define COLUMN_TYPE_DICT         0x04u    // 字典编码的属性值
 
 /*
 in stdint.h:
@@ -222,7 +317,7 @@ struct _StructIndexTable {
     uint8_t     blob[];
 };
 
-// fixed
+// fixed (块大小由所属的索引决定)
 struct _StructNode {
     uint32_t    signature;      // 块标识
     uint8_t     isLeaf;         // 是否为叶子结点
@@ -231,8 +326,62 @@ struct _StructNode {
     // 对于叶子结点，ofsExtra 为下一个相邻叶子结点的偏移量
     // 对于普通结点，ofsExtra 为比第一个键还要小的键所在结点的偏移量
     int64_t     ofsExtra;       // 补充偏移量 (局部)
+    // 对于计数的 B+ 树 (INDEX_OPTION_COUNTED) 中的普通结点，cntExtra 为 ofsExtra 所指
+    // 子树中的元素数量，其他子树的元素数量保存在数据区域中
+    int64_t     cntExtra;       // 补充子树的元素数量
+    uint8_t     __padding[8];   // 填充块头部到 32 bytes
+    uint8_t     blob[];         // 数据区域 (NODE_DATA_SIZE_OF(块大小))
+};
+
+// variant
+struct _StructFilter {
+    uint32_t    signature;      // 块标识
+    int32_t     lenBlock;       // 块长度
+    int32_t     lenActual;      // 实际内容长度
+    uint8_t     numHash;        // 哈希函数数量
+    uint8_t     __r_char;       // 保留
+    uint16_t    __r_short;      // 保留
+    int64_t     numBits;        // 位数组的位数
+    uint8_t     __padding[8];   // 填充块头部到 32 bytes
+    uint8_t     blob[];         // 位数组
+};
+
+// variant
+struct _StructHashDirectory {
+    uint32_t    signature;      // 块标识
+    int32_t     lenBlock;       // 块长度
+    int32_t     lenActual;      // 实际内容长度
+    uint8_t     globalDepth;    // 全局深度
+    uint8_t     __r_char;       // 保留
+    uint16_t    __r_short;      // 保留
     uint8_t     __padding[16];  // 填充块头部到 32 bytes
-    uint8_t     blob[NODE_DATA_SIZE];
+    uint8_t     blob[];         // 各桶的偏移量 (int64 * 2^globalDepth)
+};
+
+// fixed
+struct _StructColumnsHeader {
+    uint32_t    signature;      // 块标识
+    uint16_t    version;        // 文件版本
+    uint16_t    flags;          // 标志
+    int64_t     numRows;        // 行数 (条目数量)
+    int32_t     numColumns;     // 列数
+    int32_t     __r_int;        // 保留
+    int64_t     ofsColumns;     // 各列信息的偏移量
+    uint8_t     __padding[32];  // 填充块到 64 bytes
+};
+
+// fixed
+struct _StructColumn {
+    uint8_t     type;           // 列类型
+    uint8_t     lenName;        // 列名长度
+    uint16_t    __r_short;      // 保留
+    int32_t     numDict;        // 字典的项数 (仅用于字典编码的列)
+    int64_t     ofsName;        // 列名的偏移量
+    int64_t     ofsData;        // 数据的偏移量
+    int64_t     lenData;        // 数据的长度
+    int64_t     ofsDict;        // 字典的偏移量
+    int64_t     lenDict;        // 字典的长度
+    uint8_t     __padding[16];  // 填充块到 64 bytes
 };
 
 #include <poppack.h>
@@ -247,7 +396,11 @@ struct _PacketMetadata {
 
 struct _PacketNode {
     StructNode  *node;
-    uint8_t     blob_ex[NODE_DATA_SIZE_EXPANDED];
+    uint8_t     key_type;   // 所属索引的键类型
+    int         node_size;  // 结点的块大小
+    bool        counted;    // 是否为计数的 B+ 树中的结点
+    bool        postings;   // 元素的值是否为压缩的偏移量列表在 blob 中的位置
+    uint8_t     *blob_ex;   // 扩展的 blob (NODE_DATA_SIZE_EXPANDED_OF(node_size))
     int         distance_furthest_key;
     int64_t     offset_self;
     int64_t     offset_parent;
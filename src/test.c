@@ -3,8 +3,8 @@
 #define DEBUG_CURRENT_DIR   "D:/Projects/CodeBlocks/wpdp/bin/Debug/"
 
 static char *_filename   = DEBUG_CURRENT_DIR "_test.5dp";
-static char *_filename_m = DEBUG_CURRENT_DIR "_test.5dpi";
-static char *_filename_i = DEBUG_CURRENT_DIR "_test.5dpm";
+static char *_filename_m = DEBUG_CURRENT_DIR "_test.5dpm";
+static char *_filename_i = DEBUG_CURRENT_DIR "_test.5dpi";
 
 static char *_filename_l = DEBUG_CURRENT_DIR "_test_lookup.5dp";
 
@@ -33,7 +33,277 @@ void test_create(void) {
     assert(file_exists(_filename_i) == true);
 }
 
+#ifdef WPDP_TEST
+static char *_filename_x = DEBUG_CURRENT_DIR "_test_columns.dat";
+
+static bool _string_equals(WPDP_String *str, const char *expected) {
+    return (str->len == (int)strlen(expected)
+            && memcmp(WPDP_STRING_PTR(str), expected, (size_t)str->len) == 0);
+}
+
+static uint64_t _typed_key(uint8_t key_type, const char *value, int len) {
+    WPDP_String str;
+    uint64_t key = 0;
+
+    wpdp_string_init(&str, value, len);
+    assert(test_indexes_encode_typed_key(key_type, &str, &key) == WPDP_OK);
+    wpdp_string_clear(&str);
+
+    return key;
+}
+
+static int _typed_key_rc(uint8_t key_type, const char *value, int len) {
+    WPDP_String str;
+    uint64_t key;
+    int rc;
+
+    wpdp_string_init(&str, value, len);
+    rc = test_indexes_encode_typed_key(key_type, &str, &key);
+    wpdp_string_clear(&str);
+
+    return rc;
+}
+
+void test_postings_decode(void) {
+    // 100, +1 (1 字节), +300 (2 字节), +70000 (3 字节), +20000000 (4 字节)
+    static const uint8_t data[] = {
+        0xE4,
+        0x01,
+        0x2C, 0x01,
+        0x70, 0x11, 0x01,
+        0x00, 0x2D, 0x31, 0x01
+    };
+    uint8_t block[64];
+    uint32_t num = 5;
+    int64_t first = 100;
+    int64_t offsets[5];
+    int size, count;
+
+    memcpy(block, &num, sizeof(uint32_t));
+    memcpy(block + sizeof(uint32_t), &first, sizeof(int64_t));
+    memcpy(block + sizeof(uint32_t) + sizeof(int64_t), data, sizeof(data));
+    size = (int)(sizeof(uint32_t) + sizeof(int64_t) + sizeof(data));
+
+    assert(postings_count(block, size, &count) == WPDP_OK);
+    assert(count == 5);
+
+    assert(postings_decode(block, size, offsets) == WPDP_OK);
+    assert(offsets[0] == 100);
+    assert(offsets[1] == 101);
+    assert(offsets[2] == 401);
+    assert(offsets[3] == 70401);
+    assert(offsets[4] == 20070401);
+
+    // 最后一个差值不完整
+    assert(postings_decode(block, size - 2, offsets) == WPDP_ERROR_FILE_BROKEN);
+    // 列表头不完整
+    assert(postings_count(block, 8, &count) == WPDP_ERROR_FILE_BROKEN);
+
+    num = 0;
+    memcpy(block, &num, sizeof(uint32_t));
+    assert(postings_count(block, size, &count) == WPDP_ERROR_FILE_BROKEN);
+}
+
+void test_posting_lists(void) {
+    const int64_t list[] = {2, 4, 8, 16, 32, 64, 128};
+    const int64_t src[] = {1, 4, 5, 32, 128, 256};
+    int64_t dst[7];
+    int count;
+
+    assert(test_query_gallop(list, 0, 7, 1) == 0);
+    assert(test_query_gallop(list, 0, 7, 2) == 0);
+    assert(test_query_gallop(list, 0, 7, 9) == 3);
+    assert(test_query_gallop(list, 0, 7, 64) == 5);
+    assert(test_query_gallop(list, 3, 7, 16) == 3);
+    assert(test_query_gallop(list, 0, 7, 128) == 6);
+    assert(test_query_gallop(list, 0, 7, 129) == 7);
+    assert(test_query_gallop(list, 0, 0, 1) == 0);
+
+    memcpy(dst, list, sizeof(list));
+    count = test_query_intersect(dst, 7, src, 6);
+    assert(count == 3 && dst[0] == 4 && dst[1] == 32 && dst[2] == 128);
+
+    memcpy(dst, list, sizeof(list));
+    count = test_query_intersect(dst, 7, src, 0);
+    assert(count == 0);
+
+    memcpy(dst, list, sizeof(list));
+    count = test_query_subtract(dst, 7, src, 6);
+    assert(count == 4 && dst[0] == 2 && dst[1] == 8 && dst[2] == 16 && dst[3] == 64);
+
+    memcpy(dst, list, sizeof(list));
+    count = test_query_subtract(dst, 7, src, 0);
+    assert(count == 7 && dst[6] == 128);
+}
+
+void test_encode_typed_key(void) {
+    // 编码后的键按无符号整数比较的顺序与数值的顺序相同
+    assert(_typed_key(KEY_TYPE_INT64, "-9223372036854775808", 20) < _typed_key(KEY_TYPE_INT64, "-5", 2));
+    assert(_typed_key(KEY_TYPE_INT64, "-5", 2) < _typed_key(KEY_TYPE_INT64, "0", 1));
+    assert(_typed_key(KEY_TYPE_INT64, "0", 1) < _typed_key(KEY_TYPE_INT64, "7", 1));
+    assert(_typed_key(KEY_TYPE_INT64, "7", 1) < _typed_key(KEY_TYPE_INT64, "9223372036854775807", 19));
+
+    assert(_typed_key(KEY_TYPE_UINT64, "1", 1) < _typed_key(KEY_TYPE_UINT64, "10", 2));
+    assert(_typed_key(KEY_TYPE_UINT64, "10", 2) < _typed_key(KEY_TYPE_UINT64, "18446744073709551615", 20));
+
+    assert(_typed_key(KEY_TYPE_DOUBLE, "-1e300", 6) < _typed_key(KEY_TYPE_DOUBLE, "-1.5", 4));
+    assert(_typed_key(KEY_TYPE_DOUBLE, "-1.5", 4) < _typed_key(KEY_TYPE_DOUBLE, "-0.5", 4));
+    assert(_typed_key(KEY_TYPE_DOUBLE, "-0.5", 4) < _typed_key(KEY_TYPE_DOUBLE, "0", 1));
+    assert(_typed_key(KEY_TYPE_DOUBLE, "0", 1) < _typed_key(KEY_TYPE_DOUBLE, "2.25", 4));
+    assert(_typed_key(KEY_TYPE_DOUBLE, "2.25", 4) < _typed_key(KEY_TYPE_DOUBLE, "1e300", 5));
+
+    // 不完整或超出范围的属性值
+    assert(_typed_key_rc(KEY_TYPE_INT64, "", 0) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_INT64, " 1", 2) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_INT64, "1 ", 2) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_INT64, "12\0abc", 6) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_INT64, "9223372036854775808", 19) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_UINT64, "-1", 2) == WPDP_ERROR_INVALID_ARGUMENT);
+    assert(_typed_key_rc(KEY_TYPE_DOUBLE, "1e999", 5) == WPDP_ERROR_INVALID_ARGUMENT);
+}
+
+void test_string_tokenize(void) {
+    WPDP_String *text;
+    WPDP_String *tokens;
+    int count;
+
+    text = wpdp_string_from_cstr("Hello, World! foo-bar  ");
+    assert(wpdp_string_tokenize(text, TOKEN_FLAG_LOWERCASE, &tokens, &count) == WPDP_OK);
+    assert(count == 4);
+    assert(_string_equals(&tokens[0], "hello"));
+    assert(_string_equals(&tokens[1], "world"));
+    assert(_string_equals(&tokens[2], "foo"));
+    assert(_string_equals(&tokens[3], "bar"));
+    wpdp_free(tokens);
+
+    assert(wpdp_string_tokenize(text, TOKEN_FLAG_NONE, &tokens, &count) == WPDP_OK);
+    assert(count == 4);
+    assert(_string_equals(&tokens[0], "Hello"));
+    wpdp_free(tokens);
+    wpdp_string_free(text);
+
+    text = wpdp_string_from_cstr(" ,.; ");
+    assert(wpdp_string_tokenize(text, TOKEN_FLAG_NONE, &tokens, &count) == WPDP_OK);
+    assert(count == 0);
+    wpdp_free(tokens);
+    wpdp_string_free(text);
+}
+
+void test_columns_open(void) {
+    static int64_t data[16];    // 只有文件头，没有列 (按 8 字节对齐)
+    StructColumnsHeader *header = (StructColumnsHeader *)data;
+    WPDP_Columns *columns;
+
+    memset(data, 0, sizeof(data));
+    header->signature = COLUMNS_SIGNATURE;
+    header->version = COLUMNS_VERSION;
+    header->numRows = 0;
+    header->numColumns = 0;
+    header->ofsColumns = (int64_t)sizeof(StructColumnsHeader);
+
+    assert(wpdp_columns_open(data, sizeof(data), &columns) == WPDP_OK);
+    assert(wpdp_columns_get_row_count(columns) == 0);
+    wpdp_columns_close(columns);
+
+    // 列信息的偏移量未按 COLUMNS_ALIGNMENT 对齐
+    header->ofsColumns = (int64_t)sizeof(StructColumnsHeader) + 8;
+    assert(wpdp_columns_open(data, sizeof(data), &columns) == WPDP_ERROR_FILE_BROKEN);
+    header->ofsColumns = (int64_t)sizeof(StructColumnsHeader);
+
+    header->numRows = -1;
+    assert(wpdp_columns_open(data, sizeof(data), &columns) == WPDP_ERROR_FILE_BROKEN);
+    header->numRows = 0;
+
+    header->version = COLUMNS_VERSION + 1;
+    assert(wpdp_columns_open(data, sizeof(data), &columns) == WPDP_ERROR_NOT_COMPATIBLE);
+}
+
+void test_columns_export(void) {
+    WPIO_Stream *stream_c, *stream_m, *stream_i, *stream_x;
+    WPDP *dp;
+    WPDP_Iterator *iterator;
+    WPDP_Columns *columns;
+    StructColumnsHeader *header;
+    int64_t count = 0;
+    long length;
+    uint8_t *data;
+    FILE *fp;
+
+    if (!file_exists(_filename) || !file_exists(_filename_m) || !file_exists(_filename_i)) {
+        printf("test_columns_export: %s not found, skipped\n", _filename);
+        return;
+    }
+
+    stream_c = file_open(_filename, WPIO_MODE_READ_ONLY);
+    stream_m = file_open(_filename_m, WPIO_MODE_READ_ONLY);
+    stream_i = file_open(_filename_i, WPIO_MODE_READ_ONLY);
+    assert(wpdp_open_stream(stream_c, stream_m, stream_i, WPDP_MODE_READONLY, &dp) == WPDP_OK);
+
+    assert(wpdp_iterator_init(dp, &iterator) == WPDP_OK);
+    while (iterator->current != NULL) {
+        count++;
+        if (wpdp_iterator_next(iterator) != WPDP_OK) {
+            break;
+        }
+    }
+    wpdp_iterator_free(iterator);
+
+    // 导出到新文件
+    fp = fopen(_filename_x, "wb");
+    assert(fp != NULL);
+    fclose(fp);
+
+    stream_x = file_open(_filename_x, WPIO_MODE_READ_WRITE);
+    assert(wpdp_export_stream(dp, stream_x, WPDP_EXPORT_COLUMNS) == WPDP_OK);
+    wpio_close(stream_x);
+
+    wpdp_close(dp);
+    wpdp_free(dp);
+    wpio_close(stream_c);
+    wpio_close(stream_m);
+    wpio_close(stream_i);
+
+    // 读回导出的文件
+    fp = fopen(_filename_x, "rb");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data = malloc((size_t)length);
+    assert(fread(data, 1, (size_t)length, fp) == (size_t)length);
+    fclose(fp);
+
+    assert(wpdp_columns_open(data, length, &columns) == WPDP_OK);
+    assert(wpdp_columns_get_row_count(columns) == count);
+    wpdp_columns_close(columns);
+
+    // 损坏的文件头
+    assert(wpdp_columns_open(data, (int64_t)sizeof(StructColumnsHeader) - 1, &columns) == WPDP_ERROR_FILE_BROKEN);
+
+    header = (StructColumnsHeader *)data;
+    header->ofsColumns += 8;
+    assert(wpdp_columns_open(data, length, &columns) == WPDP_ERROR_FILE_BROKEN);
+    header->ofsColumns -= 8;
+
+    header->ofsColumns = length;
+    assert(wpdp_columns_open(data, length, &columns) == WPDP_ERROR_FILE_BROKEN);
+
+    free(data);
+    unlink(_filename_x);
+}
+#endif
+
 int main(void) {
+#ifdef WPDP_TEST
+    test_postings_decode();
+    test_posting_lists();
+    test_encode_typed_key();
+    test_string_tokenize();
+    test_columns_open();
+    test_columns_export();
+    printf("All tests passed.\n");
+#endif
+
     system("pause");
     return 0;
 
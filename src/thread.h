@@ -0,0 +1,64 @@
+#ifndef _THREAD_H_
+#define _THREAD_H_
+
+/**
+ * 线程、互斥锁与原子操作
+ *
+ * Windows 下使用 Win32 API，其他平台使用 pthread
+ */
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+typedef HANDLE              WPDP_Thread;
+typedef CRITICAL_SECTION    WPDP_Mutex;
+
+#define WPDP_THREAD_PROC(name, arg)     static DWORD WINAPI name(LPVOID arg)
+#define WPDP_THREAD_RETURN              return 0
+
+#define wpdp_thread_create(thread, proc, arg)   \
+    ((*(thread) = CreateThread(NULL, 0, proc, arg, 0, NULL)) != NULL)
+#define wpdp_thread_join(thread)        \
+    do { WaitForSingleObject(thread, INFINITE); CloseHandle(thread); } while (0)
+
+#define wpdp_mutex_init(mutex)          InitializeCriticalSection(mutex)
+#define wpdp_mutex_lock(mutex)          EnterCriticalSection(mutex)
+#define wpdp_mutex_unlock(mutex)        LeaveCriticalSection(mutex)
+#define wpdp_mutex_destroy(mutex)       DeleteCriticalSection(mutex)
+
+#define wpdp_atomic_add64(ptr, delta)   InterlockedExchangeAdd64((LONGLONG volatile *)(ptr), delta)
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_t           WPDP_Thread;
+typedef pthread_mutex_t     WPDP_Mutex;
+
+#define WPDP_THREAD_PROC(name, arg)     static void *name(void *arg)
+#define WPDP_THREAD_RETURN              return NULL
+
+#define wpdp_thread_create(thread, proc, arg)   \
+    (pthread_create(thread, NULL, proc, arg) == 0)
+#define wpdp_thread_join(thread)        pthread_join(thread, NULL)
+
+#define wpdp_mutex_init(mutex)          pthread_mutex_init(mutex, NULL)
+#define wpdp_mutex_lock(mutex)          pthread_mutex_lock(mutex)
+#define wpdp_mutex_unlock(mutex)        pthread_mutex_unlock(mutex)
+#define wpdp_mutex_destroy(mutex)       pthread_mutex_destroy(mutex)
+
+#define wpdp_atomic_add64(ptr, delta)   __sync_fetch_and_add(ptr, delta)
+
+#endif
+
+/**
+ * 线程局部变量
+ */
+#ifdef _MSC_VER
+#define WPDP_THREAD_LOCAL               __declspec(thread)
+#else
+#define WPDP_THREAD_LOCAL               __thread
+#endif
+
+#endif // _THREAD_H_
@@ -21,6 +21,12 @@
  */
 #define _FILESIZE_MAX 2113929216
 
+/**
+ * 窗口模式迭代器的窗口大小范围
+ */
+#define _WINDOW_SIZE_MIN        METADATA_BLOCK_SIZE
+#define _WINDOW_SIZE_MAX        (64 * 1024 * 1024)  // 64MB
+
 #define CHECK_DEPS() \
     if (check_dependencies()) { \
         return WPDP_ERROR; \
@@ -51,6 +57,9 @@ typedef struct _SectionFilenames {
 static int check_dependencies(void);
 static int check_capabilities(WPIO_Stream *stream, int capabilities);
 
+static int _iterator_window_load(WPDP_Iterator *iterator, int64_t offset);
+static void _iterator_release(WPDP_Iterator *iterator, PacketMetadata *meta);
+
 /*
 void wpdp_create_files(const char *filename) {
     WPDP *wpdp;
@@ -92,6 +101,20 @@ WPDP_API bool wpdp_library_compatible_with(const char *version) {
  */
 WPDP_API int wpdp_open_stream(WPIO_Stream *stream_c, WPIO_Stream *stream_m,
                                 WPIO_Stream *stream_i, WPDP_OpenMode mode, WPDP **dp_out) {
+    return wpdp_open_stream_ex(stream_c, stream_m, stream_i, mode, NULL, dp_out);
+}
+
+/**
+ * 构造函数 (带附加选项)
+ *
+ * @param stream_c 内容文件操作对象
+ * @param stream_m 元数据文件操作对象
+ * @param stream_i 索引文件操作对象
+ * @param mode     打开模式
+ * @param options  附加选项，为 NULL 时使用默认选项
+ */
+WPDP_API int wpdp_open_stream_ex(WPIO_Stream *stream_c, WPIO_Stream *stream_m, WPIO_Stream *stream_i,
+                                 WPDP_OpenMode mode, const WPDP_OpenOptions *options, WPDP **dp_out) {
     assert(IN_ARRAY_2(mode, WPDP_MODE_READONLY, WPDP_MODE_READWRITE));
 
     WPDP *dp = NULL;
@@ -151,7 +174,7 @@ WPDP_API int wpdp_open_stream(WPIO_Stream *stream_c, WPIO_Stream *stream_m,
 
     dp->_open_mode = mode;
 
-    dp->_space_available = 0;
+    wpdp_arena_init(&dp->_scratch, 0);
 
     switch (header->type) {
         case HEADER_TYPE_COMPOUND:
@@ -177,6 +200,21 @@ WPDP_API int wpdp_open_stream(WPIO_Stream *stream_c, WPIO_Stream *stream_m,
             break;
     }
 
+    // 固定各索引的上层结点
+    if (options != NULL && options->pin_memory > 0 && dp->_indexes != NULL) {
+        int rc = section_indexes_pin(dp->_indexes, options->pin_memory);
+        if (rc != WPDP_OK) {
+            // 关闭已打开的各区域并释放尚未交给调用者的对象
+            dp->_opened = true;
+            wpdp_close(dp);
+            wpdp_free(dp);
+            wpdp_free(header);
+            return rc;
+        }
+    }
+
+    wpdp_free(header);
+
     dp->_opened = true;
 
     *dp_out = dp;
@@ -193,13 +231,23 @@ WPDP_API int wpdp_close(WPDP *dp) {
         return WPDP_ERROR_BAD_FUNCTION_CALL;
     }
 
+    if (dp->_contents != NULL) {
+        section_contents_close(dp->_contents);
+    }
+    if (dp->_metadata != NULL) {
+        section_metadata_close(dp->_metadata);
+    }
+    if (dp->_indexes != NULL) {
+        section_indexes_close(dp->_indexes);
+    }
+
     dp->_contents = NULL;
     dp->_metadata = NULL;
     dp->_indexes = NULL;
 
     dp->_open_mode = 0;
 
-    dp->_space_available = 0;
+    wpdp_arena_destroy(&dp->_scratch);
 
     dp->_opened = false;
 
@@ -223,7 +271,9 @@ WPDP_API int64_t wpdp_file_space_used(WPDP *dp) {
             length += HEADER_BLOCK_SIZE * 3;
             length += section_contents_get_section_length(dp->_contents);
             length += section_metadata_get_section_length(dp->_metadata);
-//            length += dp->_indexes->getSectionLength();
+            if (dp->_indexes != NULL) {
+                length += section_indexes_get_section_length(dp->_indexes);
+            }
             if (length % BASE_BLOCK_SIZE != 0) {
                 length += BASE_BLOCK_SIZE - (length % BASE_BLOCK_SIZE);
             }
@@ -231,7 +281,9 @@ WPDP_API int64_t wpdp_file_space_used(WPDP *dp) {
         case HEADER_TYPE_COMPOUND:
             length += HEADER_BLOCK_SIZE;
             length += section_contents_get_section_length(dp->_contents);
-            length += section_metadata_get_section_length(dp->_metadata);
+            if (dp->_metadata != NULL) {
+                length += section_metadata_get_section_length(dp->_metadata);
+            }
 //            length += $this->_indexes->getSectionLength();
             break;
         case HEADER_TYPE_LOOKUP:
@@ -248,13 +300,67 @@ WPDP_API int64_t wpdp_file_space_available(WPDP *dp) {
     return _FILESIZE_MAX - wpdp_file_space_used(dp);
 }
 
+/**
+ * 获取固定在内存中的索引结点占用的内存
+ *
+ * @return 固定的结点占用的内存 (字节)
+ */
+WPDP_API int64_t wpdp_index_pinned_memory(WPDP *dp) {
+    if (dp->_indexes == NULL) {
+        return 0;
+    }
+
+    return section_indexes_get_pinned_memory(dp->_indexes);
+}
+
+/**
+ * 释放数据堆中可以重新建立的缓存
+ *
+ * 释放结点缓存、元数据的偏移量目录与查询的临时内存，固定的结点保留。用于同时打开
+ * 多个数据堆时，在某个数据堆暂时不用时主动交还内存
+ */
+WPDP_API int wpdp_release_memory(WPDP *dp) {
+    if (!dp->_opened) {
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (dp->_metadata != NULL) {
+        section_metadata_shrink(dp->_metadata);
+    }
+    if (dp->_indexes != NULL) {
+        section_indexes_shrink(dp->_indexes);
+    }
+
+    wpdp_arena_destroy(&dp->_scratch);
+
+    return WPDP_OK;
+}
+
+/**
+ * 导出到指定的流
+ *
+ * 只读的版本只支持 WPDP_EXPORT_COLUMNS
+ *
+ * @param stream  导出文件的操作对象
+ * @param type    导出类型
+ */
+WPDP_API int wpdp_export_stream(WPDP *dp, WPIO_Stream *stream, WPDP_ExportType type) {
+    switch (type) {
+        case WPDP_EXPORT_COLUMNS:
+            return columns_export(dp, stream);
+        default:
+            error_set_msg("Unsupported export type: %d", type);
+            return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
 /**
  * 获取条目迭代器
  *
  * @return WPDP_Iterator 对象
  */
 WPDP_API int wpdp_iterator_init(WPDP *dp, WPDP_Iterator **iterator_out) {
-    PacketMetadata *meta_first;
+    PacketMetadata *meta_first = NULL;
     WPDP_Iterator *iterator;
 
     section_metadata_get_first(dp->_metadata, &meta_first);
@@ -269,25 +375,230 @@ WPDP_API int wpdp_iterator_init(WPDP *dp, WPDP_Iterator **iterator_out) {
     return WPDP_OK;
 }
 
+/**
+ * 获取迭代器当前的条目
+ *
+ * 迭代器移动时会释放 (或在窗口模式下覆盖) 当前的元数据，所以条目持有元数据的
+ * 副本，在迭代器移动或释放之后仍然有效
+ *
+ * @param entry_out  条目，使用完毕后用 wpdp_entry_free() 释放
+ */
 WPDP_API int wpdp_iterator_entry(WPDP_Iterator *iterator, WPDP_Entry **entry_out) {
+    PacketMetadata meta;
     WPDP_Entry *entry;
 
-    entry = wpdp_entry_create(iterator->dp, iterator->current);
+    if (iterator->current == NULL) {
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    int len_block = iterator->current->metadata->lenBlock;
+    int size = (len_block > (int)sizeof(StructMetadata)) ? len_block : (int)sizeof(StructMetadata);
+
+    meta.metadata = wpdp_malloc_zero(size);
+    meta.offset = iterator->current->offset;
+    memcpy(meta.metadata, iterator->current->metadata, (size_t)len_block);
+
+    entry = wpdp_entry_create(iterator->dp, &meta, NULL);
+    entry->owns_metadata = true;
 
     *entry_out = entry;
 
     return WPDP_OK;
 }
 
+/**
+ * 获取窗口模式的条目迭代器
+ *
+ * 元数据区域按 window_size 大小的块顺序读取，迭代器的当前元数据直接指向窗口中的
+ * 数据，不为每个条目分配内存，占用的内存与条目数量无关。当前元数据只在移动迭代器
+ * 之前有效 (wpdp_iterator_entry() 返回的条目持有副本，不受影响)。适合顺序扫描
+ * 全部条目
+ *
+ * @param window_size   窗口大小 (字节)，建议为 1MB ~ 8MB
+ * @param iterator_out  迭代器，使用完毕后用 wpdp_iterator_free() 释放
+ */
+WPDP_API int wpdp_iterator_init_windowed(WPDP *dp, int window_size, WPDP_Iterator **iterator_out) {
+    WPDP_Iterator *iterator;
+
+    if (window_size < _WINDOW_SIZE_MIN || window_size > _WINDOW_SIZE_MAX) {
+        error_set_msg("Invalid window size: %d", window_size);
+        return WPDP_ERROR_INVALID_ARGUMENT;
+    }
+
+    iterator = wpdp_new_zero(WPDP_Iterator, 1);
+    iterator->dp = dp;
+    iterator->window.buffer = wpdp_malloc_zero(window_size);
+    iterator->window.capacity = window_size;
+    wpdp_memory_charge(WPDP_MEMORY_BUFFERS, window_size);
+
+    int64_t offset = section_metadata_get_first_offset(dp->_metadata);
+    if (offset != 0) {
+        int rc = _iterator_window_load(iterator, offset);
+        if (rc != WPDP_OK) {
+            wpdp_iterator_free(iterator);
+            return rc;
+        }
+        iterator->first = iterator->current;
+    }
+
+    *iterator_out = iterator;
+
+    return WPDP_OK;
+}
+
+/**
+ * 释放迭代器
+ */
+WPDP_API int wpdp_iterator_free(WPDP_Iterator *iterator) {
+    if (iterator->window.buffer != NULL) {
+        wpdp_memory_uncharge(WPDP_MEMORY_BUFFERS, iterator->window.capacity);
+        wpdp_free(iterator->window.buffer);
+    } else {
+        _iterator_release(iterator, iterator->current);
+        iterator->current = NULL;
+
+        // _iterator_release() 不释放第一个条目的元数据
+        if (iterator->first != NULL) {
+            section_metadata_release(iterator->dp->_metadata, iterator->first);
+            iterator->first = NULL;
+        }
+    }
+
+    wpdp_free(iterator);
+
+    return WPDP_OK;
+}
+
+/**
+ * 把迭代器移到下一个条目
+ *
+ * @return 已经是最后一个条目时返回 WPDP_ERROR_OUT_OF_BOUNDS，迭代器不变
+ */
 WPDP_API int wpdp_iterator_next(WPDP_Iterator *iterator) {
     PacketMetadata *meta_next;
-    section_metadata_get_next(iterator->dp->_metadata, iterator->current, &meta_next);
 
+    if (iterator->current == NULL) {
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (iterator->window.buffer != NULL) {
+        int64_t offset_next = iterator->view.offset + iterator->view.metadata->lenBlock;
+        if (offset_next >= section_metadata_get_section_length(iterator->dp->_metadata)) {
+            return WPDP_ERROR_OUT_OF_BOUNDS;
+        }
+        return _iterator_window_load(iterator, offset_next);
+    }
+
+    int rc = section_metadata_get_next(iterator->dp->_metadata, iterator->current, &meta_next);
+    if (rc != WPDP_OK) {
+        return WPDP_ERROR_OUT_OF_BOUNDS;
+    }
+
+    _iterator_release(iterator, iterator->current);
     iterator->current = meta_next;
 
     return WPDP_OK;
 }
 
+/**
+ * 把迭代器移到前一个条目
+ *
+ * 第一次调用时需要建立元数据的偏移量目录，之后每次只需读取一个元数据
+ *
+ * @return 已经是第一个条目时返回 WPDP_ERROR_OUT_OF_BOUNDS，迭代器不变
+ */
+WPDP_API int wpdp_iterator_prev(WPDP_Iterator *iterator) {
+    PacketMetadata *meta_prev;
+
+    if (iterator->current == NULL) {
+        return WPDP_ERROR_BAD_FUNCTION_CALL;
+    }
+
+    if (iterator->window.buffer != NULL) {
+        int64_t index;
+        int64_t offset;
+        int rc = section_metadata_get_index_of(iterator->dp->_metadata, iterator->view.offset, &index);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        if (index == 0) {
+            return WPDP_ERROR_OUT_OF_BOUNDS;
+        }
+        rc = section_metadata_get_offset_at(iterator->dp->_metadata, index - 1, &offset);
+        RETURN_VAL_IF_NON_ZERO(rc);
+        return _iterator_window_load(iterator, offset);
+    }
+
+    int rc = section_metadata_get_prev(iterator->dp->_metadata, iterator->current, &meta_prev);
+    if (rc == WPDP_ERROR) {
+        return WPDP_ERROR_OUT_OF_BOUNDS;
+    }
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    _iterator_release(iterator, iterator->current);
+    iterator->current = meta_prev;
+
+    return WPDP_OK;
+}
+
+/**
+ * 把迭代器移到第 n 个条目
+ *
+ * @param n  序号 (从 0 开始)
+ */
+WPDP_API int wpdp_iterator_seek(WPDP_Iterator *iterator, int64_t n) {
+    PacketMetadata *meta;
+    int64_t offset;
+
+    int rc = section_metadata_get_offset_at(iterator->dp->_metadata, n, &offset);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    if (iterator->window.buffer != NULL) {
+        return _iterator_window_load(iterator, offset);
+    }
+
+    rc = section_metadata_get_metadata(iterator->dp->_metadata, offset, &meta);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    _iterator_release(iterator, iterator->current);
+    iterator->current = meta;
+
+    return WPDP_OK;
+}
+
+/**
+ * 获取条目的数量
+ *
+ * @param count_out  条目的数量
+ */
+WPDP_API int wpdp_entry_count(WPDP *dp, int64_t *count_out) {
+    return section_metadata_get_count(dp->_metadata, count_out);
+}
+
+/**
+ * 获取第 n 个条目
+ *
+ * 使用元数据的偏移量目录直接定位，只需读取一个元数据，可以用于随机抽样
+ *
+ * @param n          序号 (从 0 开始)
+ * @param entry_out  条目
+ */
+WPDP_API int wpdp_entry_at(WPDP *dp, int64_t n, WPDP_Entry **entry_out) {
+    PacketMetadata *meta;
+    int64_t offset;
+
+    int rc = section_metadata_get_offset_at(dp->_metadata, n, &offset);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    rc = section_metadata_get_metadata(dp->_metadata, offset, &meta);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    *entry_out = wpdp_entry_create(dp, meta, NULL);
+    (*entry_out)->owns_metadata = true;
+    meta->metadata = NULL;
+    section_metadata_release(dp->_metadata, meta);
+
+    return WPDP_OK;
+}
+
 /**
  * 查询指定属性值的条目
  *
@@ -297,7 +608,79 @@ WPDP_API int wpdp_iterator_next(WPDP_Iterator *iterator) {
  * @return 成功时返回 WPDP_Entries 对象，指定属性不存在索引时返回 false
  */
 WPDP_API void *wpdp_query(WPDP *dp, const char *attr_name, const char *attr_value) {
-    return NULL;
+    WPDP_String name;
+    WPDP_Entries *entries = NULL;
+    WPDP_Condition cond;
+
+    if (dp->_indexes == NULL) {
+        return NULL;
+    }
+
+    name = wpdp_string_view(attr_name, (int)strlen(attr_name));
+
+    if (!section_indexes_exists(dp->_indexes, &name)) {
+        return NULL;
+    }
+
+    cond.name = attr_name;
+    cond.value = attr_value;
+    cond.negate = false;
+
+    if (wpdp_query_all(dp, &cond, 1, &entries) != WPDP_OK) {
+        return NULL;
+    }
+
+    return entries;
+}
+
+/**
+ * 获取所有建立了索引的属性名
+ *
+ * 返回的属性名在数据堆关闭前一直有效，调用者不应修改或释放
+ *
+ * @param names_out  属性名数组
+ * @param count_out  索引数量
+ */
+WPDP_API int wpdp_index_list(WPDP *dp, WPDP_String ***names_out, int *count_out) {
+    if (dp->_indexes == NULL) {
+        *names_out = NULL;
+        *count_out = 0;
+        return WPDP_OK;
+    }
+
+    return section_indexes_list(dp->_indexes, names_out, count_out);
+}
+
+/**
+ * 使窗口模式迭代器的当前条目指向指定偏移量的元数据
+ *
+ * 窗口的读取与检查见 section_metadata_load_window()
+ *
+ * @param offset  元数据的偏移量
+ */
+static int _iterator_window_load(WPDP_Iterator *iterator, int64_t offset) {
+    StructMetadata *metadata;
+    int rc;
+
+    rc = section_metadata_load_window(iterator->dp->_metadata, &iterator->window, offset, NULL, &metadata);
+    RETURN_VAL_IF_NON_ZERO(rc);
+
+    iterator->view.metadata = metadata;
+    iterator->view.offset = offset;
+    iterator->current = &iterator->view;
+
+    return WPDP_OK;
+}
+
+/**
+ * 释放迭代器不再使用的元数据 (第一个条目一直保留)
+ */
+static void _iterator_release(WPDP_Iterator *iterator, PacketMetadata *meta) {
+    if (meta == NULL || meta == iterator->first) {
+        return;
+    }
+
+    section_metadata_release(iterator->dp->_metadata, meta);
 }
 
 static int check_dependencies(void) {
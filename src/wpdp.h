@@ -10,6 +10,9 @@ typedef enum _WPDP_CacheMode        WPDP_CacheMode;
 typedef enum _WPDP_CompressionType  WPDP_CompressionType;
 typedef enum _WPDP_ChecksumType     WPDP_ChecksumType;
 typedef enum _WPDP_ExportType       WPDP_ExportType;
+typedef enum _WPDP_ExprType         WPDP_ExprType;
+typedef enum _WPDP_MemoryComponent  WPDP_MemoryComponent;
+typedef enum _WPDP_StringMode       WPDP_StringMode;
 
 typedef struct _WPDP                WPDP;
 
@@ -24,6 +27,21 @@ typedef struct _WPDP_String             WPDP_String;
 
 typedef struct _WPDP_Iterator       WPDP_Iterator;
 typedef struct _WPDP_Entries        WPDP_Entries;
+typedef struct _WPDP_Condition      WPDP_Condition;
+typedef struct _WPDP_OpenOptions    WPDP_OpenOptions;
+typedef struct _WPDP_Expr           WPDP_Expr;
+typedef struct _WPDP_Predicate      WPDP_Predicate;
+typedef struct _WPDP_Columns        WPDP_Columns;
+typedef struct _WPDP_MemoryStats    WPDP_MemoryStats;
+typedef struct _WPDP_Allocator      WPDP_Allocator;
+typedef struct _WPDP_MetadataWindow WPDP_MetadataWindow;
+
+// 批量查找的回调函数，返回非 0 值时停止查找
+typedef int (*WPDP_QueryCallback)(void *arg, int index, const int64_t *offsets, int count);
+// 覆盖索引查找的回调函数，返回非 0 值时停止查找
+typedef int (*WPDP_CoveringCallback)(void *arg, int64_t offset, const WPDP_String *values, int count);
+// 扫描的回调函数，返回非 0 值时停止扫描
+typedef int (*WPDP_ScanCallback)(void *arg, WPDP_Entry *entry);
 
 /**
  * 打开模式常量
@@ -64,7 +82,27 @@ enum _WPDP_ChecksumType {
  * 导出类型常量
  */
 enum _WPDP_ExportType {
-    WPDP_EXPORT_LOOKUP = 0x06   // 用于查找条目的文件
+    WPDP_EXPORT_LOOKUP = 0x06,  // 用于查找条目的文件
+    WPDP_EXPORT_COLUMNS = 0x40  // 列式的元数据文件 (用于统计分析)
+};
+
+/**
+ * 内存用途常量
+ */
+enum _WPDP_MemoryComponent {
+    WPDP_MEMORY_NODE_CACHE = 0,     // 索引结点的缓存 (含固定的结点)
+    WPDP_MEMORY_METADATA_CACHE = 1, // 元数据的偏移量目录与元数据包的对象池
+    WPDP_MEMORY_BUFFERS = 2,        // 读写缓冲区与临时内存
+    WPDP_MEMORY_COMPONENTS = 3      // 用途的数量
+};
+
+/**
+ * 字符串的存储方式常量
+ */
+enum _WPDP_StringMode {
+    WPDP_STRING_BORROWED = 0,   // 指向调用者的内存 (不负责释放)
+    WPDP_STRING_OWNED = 1,      // 指向自己分配的内存
+    WPDP_STRING_INLINE = 2      // 短字符串，数据保存在结构体内部
 };
 
 // WPDP.php: class WPDP
@@ -83,17 +121,21 @@ struct _WPDP {
     uint8_t             _file_limit;
     // 当前数据堆的操作信息
     bool                _opened;
-    int64_t             _space_available;
     // Add
     WPIO_Stream         *_stream_c;
     WPIO_Stream         *_stream_m;
     WPIO_Stream         *_stream_i;
+    WPDP_Arena          _scratch;           // 单次查询中的临时内存
 };
 
 struct _WPDP_Entry {
     WPDP                    *dp;
     WPDP_Entry_Info         *info;
     WPDP_Entry_Attributes   *attributes;
+    // 条目的原始元数据，属性在读取时才从中解析
+    StructMetadata          *metadata;
+    int64_t                 offset;             // 元数据的偏移量
+    bool                    owns_metadata;      // 是否由条目负责释放元数据
 };
 
 // Entry.php: class WPDP_Entry_Information
@@ -124,23 +166,110 @@ struct _WPDP_String_Builder {
     int     capacity;
 };
 
+#define WPDP_STRING_INLINE_SIZE     24  // 内联数据的容量 (含结尾的 '\0')
+
+// 字符串 (值类型)
+//
+// 内联模式下 str 无效，读取数据一律使用 WPDP_STRING_PTR()。全部清零的字符串为借用
+// 模式的空字符串。复制拥有模式的字符串时只复制指针，只能释放其中一个
 struct _WPDP_String {
-    void    *str;
     int     len;
+    uint8_t mode;   // 存储方式 (WPDP_STRING_*)
+    union {
+        void    *str;                           // 借用与拥有模式下的数据
+        uint8_t buf[WPDP_STRING_INLINE_SIZE];   // 内联模式下的数据
+    };
+};
+
+// 字符串数据的地址
+#define WPDP_STRING_PTR(s) \
+    ((s)->mode == WPDP_STRING_INLINE ? (void *)(s)->buf : (s)->str)
+
+// 借用指定内存的字符串 (不复制数据)
+#define wpdp_string_view(ptr, n) \
+    ((WPDP_String){ .len = (n), .mode = WPDP_STRING_BORROWED, .str = (void *)(ptr) })
+
+// 元数据区域的窗口: 按大块顺序读取元数据区域 (窗口模式的迭代器与并行扫描使用)
+struct _WPDP_MetadataWindow {
+    uint8_t         *buffer;            // 窗口缓冲区
+    int             capacity;           // 窗口缓冲区的大小
+    int64_t         offset;             // 窗口中数据在区域中的偏移量
+    int             length;             // 窗口中数据的长度
 };
 
 struct _WPDP_Iterator {
     WPDP            *dp;
     PacketMetadata  *first;
     PacketMetadata  *current;
+    // 窗口模式: 按大块顺序读取元数据区域，当前条目直接指向窗口中的数据
+    WPDP_MetadataWindow window;         // 窗口，缓冲区为 NULL 时不使用窗口模式
+    PacketMetadata  view;               // 窗口模式的当前条目
 };
 
 struct _WPDP_Entries {
     WPDP        *dp;
-//    GArray      *offsets;
+    int64_t     *offsets;   // 各条目元数据的偏移量 (复合查询为升序，分页查询按属性值排序)
+    int         count;
     int         position;
 };
 
+// 复合查询的单个条件
+struct _WPDP_Condition {
+    const char  *name;      // 属性名
+    const char  *value;     // 属性值
+    bool        negate;     // 是否取反 (NOT)
+};
+
+/**
+ * 扫描表达式的类型常量
+ */
+enum _WPDP_ExprType {
+    WPDP_EXPR_EQUAL = 1,        // 属性值等于 value
+    WPDP_EXPR_RANGE = 2,        // 属性值在 [value, hi] 内，value 或 hi 为 NULL 时该端不限制
+    WPDP_EXPR_PREFIX = 3,       // 属性值以 value 开头
+    WPDP_EXPR_EXISTS = 4,       // 存在属性 name
+    WPDP_EXPR_SIZE = 5,         // 内容原始长度在 [min, max] 内
+    WPDP_EXPR_COMPRESSION = 6,  // 内容的压缩算法为 compression
+    WPDP_EXPR_AND = 7,          // children 都满足
+    WPDP_EXPR_OR = 8,           // children 任一满足
+    WPDP_EXPR_NOT = 9           // children[0] 不满足
+};
+
+// 扫描表达式
+struct _WPDP_Expr {
+    WPDP_ExprType       type;
+    const char          *name;          // 属性名
+    const char          *value;         // 属性值，或范围的下限
+    const char          *hi;            // 范围的上限
+    int64_t             min;            // 内容原始长度的下限
+    int64_t             max;            // 内容原始长度的上限
+    int                 compression;    // 压缩算法
+    const WPDP_Expr     *children;      // 子表达式 (仅用于 AND、OR、NOT)
+    int                 count;          // 子表达式数量
+};
+
+// 打开数据堆的附加选项
+struct _WPDP_OpenOptions {
+    int64_t     pin_memory; // 固定在内存中的索引内部结点可以占用的内存上限 (字节)，为 0 时不固定
+};
+
+// 内存使用情况 (所有数据堆合计)
+struct _WPDP_MemoryStats {
+    int64_t     limit;                              // 内存上限，为 0 时表示不限制
+    int64_t     total;                              // 当前使用的内存
+    int64_t     components[WPDP_MEMORY_COMPONENTS]; // 各用途使用的内存 (按 WPDP_MEMORY_* 取下标)
+};
+
+// 分配器 (各函数的第一个参数为 ctx，释放时传入分配时的大小)
+struct _WPDP_Allocator {
+    void    *(*alloc)(void *ctx, size_t size);
+    void    *(*realloc)(void *ctx, void *p, size_t old_size, size_t new_size);    // 可以为 NULL
+    void    (*free)(void *ctx, void *p, size_t size);
+    void    *(*alloc_aligned)(void *ctx, size_t size, size_t alignment);        // 可以为 NULL
+    void    (*free_aligned)(void *ctx, void *p, size_t size, size_t alignment); // 可以为 NULL
+    void    *ctx;
+};
+
 WPDP_API char *wpdp_library_version(void);
 WPDP_API bool wpdp_library_compatible_with(const char *version);
 
@@ -154,6 +283,17 @@ WPDP_API int wpdp_open_stream(
     WPDP_OpenMode mode,     // 打开模式
     WPDP **wpdp
 );
+/**
+ * 构造函数 (带附加选项)
+ */
+WPDP_API int wpdp_open_stream_ex(
+    WPIO_Stream *stream_c,  // 内容文件操作对象
+    WPIO_Stream *stream_m,  // 元数据文件操作对象
+    WPIO_Stream *stream_i,  // 索引文件操作对象
+    WPDP_OpenMode mode,     // 打开模式
+    const WPDP_OpenOptions *options,    // 附加选项，可以为 NULL
+    WPDP **wpdp
+);
 
 /*
 WPDP_API WPDP *wpdp_open(const char *filename, WPDP_OpenMode mode);
@@ -178,23 +318,156 @@ WPDP_API int64_t wpdp_file_space_used(WPDP *dp);
  * @return integer 获取当前数据堆的可用空间
  */
 WPDP_API int64_t wpdp_file_space_available(WPDP *dp);
+/**
+ * 获取固定在内存中的索引结点占用的内存
+ *
+ * @return integer 固定的结点占用的内存 (字节)
+ */
+WPDP_API int64_t wpdp_index_pinned_memory(WPDP *dp);
+
+/**
+ * 设置所有数据堆共用的内存上限 (为 0 时不限制)
+ */
+WPDP_API int wpdp_set_memory_limit(int64_t limit);
+/**
+ * 获取当前的内存使用情况
+ */
+WPDP_API int wpdp_get_memory_stats(WPDP_MemoryStats *stats_out);
+/**
+ * 设置分配器 (只能在第一次分配内存之前调用，为 NULL 时恢复使用 malloc/free)
+ */
+WPDP_API int wpdp_set_allocator(const WPDP_Allocator *allocator);
+/**
+ * 释放数据堆中可以重新建立的缓存
+ */
+WPDP_API int wpdp_release_memory(WPDP *dp);
+
+/**
+ * 导出到指定的流
+ */
+WPDP_API int wpdp_export_stream(WPDP *dp, WPIO_Stream *stream, WPDP_ExportType type);
+
+/**
+ * 读取映射到内存中的列式文件 (由 WPDP_EXPORT_COLUMNS 导出)
+ */
+WPDP_API int wpdp_columns_open(const void *data, int64_t length, WPDP_Columns **columns_out);
+WPDP_API int wpdp_columns_close(WPDP_Columns *columns);
+WPDP_API int64_t wpdp_columns_get_row_count(WPDP_Columns *columns);
+WPDP_API int wpdp_columns_sum(WPDP_Columns *columns, const char *name, int64_t *sum_out);
+WPDP_API int wpdp_columns_count_value(WPDP_Columns *columns, const char *name, const char *value,
+                                      int64_t *count_out);
 
 /**
  * 获取条目迭代器
  */
 WPDP_API int wpdp_iterator_init(WPDP *dp, WPDP_Iterator **iterator_out);
 WPDP_API int wpdp_iterator_next(WPDP_Iterator *iterator);
+/**
+ * 获取窗口模式的条目迭代器 (用于顺序扫描全部条目)
+ */
+WPDP_API int wpdp_iterator_init_windowed(WPDP *dp, int window_size, WPDP_Iterator **iterator_out);
+WPDP_API int wpdp_iterator_free(WPDP_Iterator *iterator);
+/**
+ * 把迭代器移到前一个条目 (用于反向遍历)
+ */
+WPDP_API int wpdp_iterator_prev(WPDP_Iterator *iterator);
+/**
+ * 把迭代器移到第 n 个条目 (从 0 开始)
+ */
+WPDP_API int wpdp_iterator_seek(WPDP_Iterator *iterator, int64_t n);
+
+/**
+ * 获取条目的数量
+ */
+WPDP_API int wpdp_entry_count(WPDP *dp, int64_t *count_out);
+/**
+ * 获取第 n 个条目 (从 0 开始)
+ */
+WPDP_API int wpdp_entry_at(WPDP *dp, int64_t n, WPDP_Entry **entry_out);
+WPDP_API int wpdp_entry_free(WPDP_Entry *entry);
+/**
+ * 获取条目指定名称的属性值 (不分配内存，属性值直接指向条目的元数据)
+ */
+WPDP_API int wpdp_entry_get_attr(WPDP_Entry *entry, const char *name, WPDP_String *view_out);
+/**
+ * 依次获取条目的各个属性 (不分配内存)，*pos 初始为 0
+ */
+WPDP_API int wpdp_entry_next_attr(WPDP_Entry *entry, int *pos, WPDP_String *name_out, WPDP_String *value_out);
 
 WPDP_API void *wpdp_query(WPDP *dp, const char *attr_name, const char *attr_value);
 
+/**
+ * 编译扫描用的谓词
+ */
+WPDP_API int wpdp_predicate_compile(const WPDP_Expr *expr, WPDP_Predicate **pred_out);
+WPDP_API int wpdp_predicate_free(WPDP_Predicate *pred);
+/**
+ * 扫描全部条目，对满足谓词的条目调用回调函数 (用于不存在索引的条件)
+ */
+WPDP_API int wpdp_scan(WPDP *dp, const WPDP_Predicate *pred, WPDP_ScanCallback callback, void *arg);
+/**
+ * 用多个线程并行扫描全部条目 (ordered 为 true 时按条目的顺序调用回调函数)
+ */
+WPDP_API int wpdp_scan_parallel(WPDP *dp, const WPDP_Predicate *pred, int threads, bool ordered,
+                                WPDP_ScanCallback callback, void *arg);
+
+/**
+ * 复合查询，所有条件都满足 (AND)
+ */
+WPDP_API int wpdp_query_all(WPDP *dp, const WPDP_Condition *conds, int n, WPDP_Entries **entries_out);
+/**
+ * 复合查询，任一条件满足 (OR)
+ */
+WPDP_API int wpdp_query_any(WPDP *dp, const WPDP_Condition *conds, int n, WPDP_Entries **entries_out);
+WPDP_API int wpdp_entries_free(WPDP_Entries *entries);
+/**
+ * 统计属性值在指定范围内的条目数量 (仅用于计数的 B+ 树索引)
+ */
+WPDP_API int wpdp_query_count(WPDP *dp, const char *attr_name, const char *lo, const char *hi,
+                              int64_t *count_out);
+/**
+ * 按属性值的顺序分页取得指定范围内的条目 (仅用于计数的 B+ 树索引)
+ */
+WPDP_API int wpdp_query_range(WPDP *dp, const char *attr_name, const char *lo, const char *hi,
+                              int64_t skip, int limit, WPDP_Entries **entries_out);
+/**
+ * 在分词索引中查找含有所有给定词的条目
+ */
+WPDP_API int wpdp_query_tokens(WPDP *dp, const char *attr_name, const char *text, WPDP_Entries **entries_out);
+/**
+ * 在覆盖索引中查找，直接从索引中取得附带的属性值而不读取元数据
+ */
+WPDP_API int wpdp_query_covering(WPDP *dp, const char *attr_name, const char *attr_value,
+                                 WPDP_CoveringCallback callback, void *arg);
+/**
+ * 获取覆盖索引中附带的属性名
+ */
+WPDP_API int wpdp_index_covered(WPDP *dp, const char *attr_name, WPDP_String **names_out, int *count_out);
+/**
+ * 批量查找同一属性的多个属性值
+ */
+WPDP_API int wpdp_query_many(WPDP *dp, const char *attr_name, const char **keys, int n,
+                             WPDP_QueryCallback callback, void *arg);
+
+/**
+ * 获取所有建立了索引的属性名
+ */
+WPDP_API int wpdp_index_list(WPDP *dp, WPDP_String ***names_out, int *count_out);
+
 WPDP_String_Builder *wpdp_string_builder_create(int init_capacity);
 int wpdp_string_builder_append(WPDP_String_Builder *builder, void *data, int len);
 int wpdp_string_builder_free(WPDP_String_Builder *builder);
 
+int wpdp_string_init(WPDP_String *str, const void *data, int len);
+void wpdp_string_clear(WPDP_String *str);
+
 WPDP_String *wpdp_string_direct(void *str, int len);
 WPDP_String *wpdp_string_create(const char *str, int len);
 WPDP_String *wpdp_string_from_cstr(const char *str);
 int wpdp_string_compare(WPDP_String *str_1, WPDP_String *str_2);
+uint32_t wpdp_string_hash(WPDP_String *str);
+uint64_t wpdp_string_hash64(WPDP_String *str);
+int wpdp_string_tokenize(WPDP_String *text, uint8_t flags, WPDP_String **tokens_out, int *count_out);
 int wpdp_string_free(WPDP_String *str);
 
 #endif // _WPDP_H_